@@ -176,26 +176,83 @@ inline void init_leaper_attacks() {
     }
 }
 
-inline void init_slider_attacks(int is_bishop) {
+// Fill one piece type's slices of the packed table starting at 'offset';
+// returns the offset just past the last slice
+inline int init_slider_magics(SliderMagic magics[64], bool is_bishop, int backend, int offset) {
     for (int square = 0; square < 64; square++) {
-        bishop_masks[square] = mask_bishop_attacks(square);
-        rook_masks[square] = mask_rook_attacks(square);
+        SliderMagic& m = magics[square];
+        int relevant_bits = is_bishop ? BISHOP_RELEVANT_BITS[square] : ROOK_RELEVANT_BITS[square];
         
-        U64 attack_mask = is_bishop ? bishop_masks[square] : rook_masks[square];
-        int relevant_bits = Position::count_bits(attack_mask);
-        int occupancy_count = (1 << relevant_bits);
+        m.mask = is_bishop ? mask_bishop_attacks(square) : mask_rook_attacks(square);
+        m.magic = is_bishop ? BISHOP_MAGIC_NUMBERS[square] : ROOK_MAGIC_NUMBERS[square];
+        m.shift = 64 - relevant_bits;
+        m.attacks = slider_attack_table + offset;
         
+        int occupancy_count = 1 << relevant_bits;
         for (int index = 0; index < occupancy_count; index++) {
-            if (is_bishop) {
-                U64 occ = set_occupancy(index, relevant_bits, attack_mask);
-                int magic_index = (occ * BISHOP_MAGIC_NUMBERS[square]) >> 
-                                  (64 - BISHOP_RELEVANT_BITS[square]);
-                bishop_attacks[square][magic_index] = bishop_attacks_on_the_fly(square, occ);
-            } else {
-                U64 occ = set_occupancy(index, relevant_bits, attack_mask);
-                int magic_index = (occ * ROOK_MAGIC_NUMBERS[square]) >> 
-                                  (64 - ROOK_RELEVANT_BITS[square]);
-                rook_attacks[square][magic_index] = rook_attacks_on_the_fly(square, occ);
+            U64 occ = set_occupancy(index, relevant_bits, m.mask);
+            unsigned table_index = (backend == SLIDER_PEXT)
+                ? static_cast<unsigned>(pext_u64(occ, m.mask))
+                : static_cast<unsigned>((occ * m.magic) >> m.shift);
+            m.attacks[table_index] = is_bishop ? bishop_attacks_on_the_fly(square, occ)
+                                               : rook_attacks_on_the_fly(square, occ);
+        }
+        offset += occupancy_count;
+    }
+    return offset;
+}
+
+// (Re)build the packed slider table for the given backend
+inline void init_slider_attacks(int backend) {
+    slider_backend = backend;
+    int offset = init_slider_magics(rook_magics, false, backend, 0);
+    init_slider_magics(bishop_magics, true, backend, offset);
+}
+
+// True if the CPU implements BMI2 (PEXT)
+inline bool cpu_has_pext() {
+#if BATU_PEXT_AVAILABLE && !defined(_MSC_VER)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#elif BATU_PEXT_AVAILABLE
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 8)) != 0;   // EBX bit 8 = BMI2
+#else
+    return false;
+#endif
+}
+
+// True if PEXT is also fast: Zen 1/2 implement it in microcode, far slower
+// than a magic multiply
+inline bool cpu_has_fast_pext() {
+#if BATU_PEXT_AVAILABLE && !defined(_MSC_VER)
+    if (__builtin_cpu_is("znver1") || __builtin_cpu_is("znver2")) return false;
+#endif
+    return cpu_has_pext();
+}
+
+inline const char* slider_backend_name(int backend) {
+    return backend == SLIDER_PEXT ? "PEXT" : "Magic";
+}
+
+// Between/line tables for check evasion and pin masks (legal move generation)
+inline void init_between_line_masks() {
+    for (int s1 = 0; s1 < 64; s1++) {
+        for (int s2 = 0; s2 < 64; s2++) {
+            between_masks[s1][s2] = 0ULL;
+            line_masks[s1][s2] = 0ULL;
+            if (s1 == s2) continue;
+            
+            U64 bb1 = 1ULL << s1;
+            U64 bb2 = 1ULL << s2;
+            
+            if (rook_attacks_on_the_fly(s1, 0ULL) & bb2) {
+                between_masks[s1][s2] = rook_attacks_on_the_fly(s1, bb2) & rook_attacks_on_the_fly(s2, bb1);
+                line_masks[s1][s2] = (rook_attacks_on_the_fly(s1, 0ULL) & rook_attacks_on_the_fly(s2, 0ULL)) | bb1 | bb2;
+            } else if (bishop_attacks_on_the_fly(s1, 0ULL) & bb2) {
+                between_masks[s1][s2] = bishop_attacks_on_the_fly(s1, bb2) & bishop_attacks_on_the_fly(s2, bb1);
+                line_masks[s1][s2] = (bishop_attacks_on_the_fly(s1, 0ULL) & bishop_attacks_on_the_fly(s2, 0ULL)) | bb1 | bb2;
             }
         }
     }
@@ -203,8 +260,8 @@ inline void init_slider_attacks(int is_bishop) {
 
 inline void init_all() {
     init_leaper_attacks();
-    init_slider_attacks(BISHOP);
-    init_slider_attacks(ROOK);
+    init_slider_attacks(cpu_has_fast_pext() ? SLIDER_PEXT : SLIDER_MAGIC);
+    init_between_line_masks();
 }
 
 } // namespace AttackTables
@@ -0,0 +1,69 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Evaluation Cache
+// =============================================================================
+//
+// Direct-mapped table of static evaluations keyed by the Zobrist hash, shared
+// by all search threads. A position reached again through a transposition,
+// or evaluated by both the main search and quiescence, costs one lookup
+// instead of another NN forward pass.
+//
+// Each entry is a single 64-bit word: the upper 32 key bits (the lower bits
+// select the slot) and the 32-bit score. One atomic word cannot tear, so
+// threads share the table without locks.
+//
+// Sized by the EvalCache UCI option in MB (0 disables it). Scores depend on
+// the evaluator, so the cache is cleared whenever UseNN changes.
+//
+// =============================================================================
+
+#include "types.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace EvalCache {
+
+constexpr int DEFAULT_MB = 1;
+constexpr int MAX_MB = 1024;
+constexpr U64 KEY_MASK = 0xffffffff00000000ULL;
+
+inline std::unique_ptr<std::atomic<U64>[]> table;
+inline U64 mask = 0;               // Entries - 1 (table is empty when null)
+
+inline void clear() {
+    if (!table) return;
+    for (U64 i = 0; i <= mask; i++)
+        table[i].store(0, std::memory_order_relaxed);
+}
+
+// Largest power-of-two entry count that fits in 'mb' megabytes
+inline void resize(int mb) {
+    table.reset();
+    mask = 0;
+    if (mb <= 0) return;
+
+    U64 entries = 1;
+    while (entries * 2 * sizeof(std::atomic<U64>) <= static_cast<U64>(mb) << 20)
+        entries *= 2;
+
+    table.reset(new std::atomic<U64>[entries]);
+    mask = entries - 1;
+    clear();
+}
+
+inline bool probe(U64 key, int& score) {
+    if (!table) return false;
+    U64 entry = table[key & mask].load(std::memory_order_relaxed);
+    if ((entry & KEY_MASK) != (key & KEY_MASK)) return false;
+    score = static_cast<int32_t>(static_cast<uint32_t>(entry));
+    return true;
+}
+
+inline void store(U64 key, int score) {
+    if (!table) return;
+    table[key & mask].store((key & KEY_MASK) | static_cast<uint32_t>(score), std::memory_order_relaxed);
+}
+
+} // namespace EvalCache
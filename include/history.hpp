@@ -0,0 +1,87 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Quiet Move History
+// =============================================================================
+//
+// Statistics learned during the search that order quiet moves and steer
+// late move reductions:
+//   - Butterfly history: [side][from][to], how often a quiet move caused a
+//     beta cutoff anywhere in the tree
+//   - Countermoves: [piece][to] of the previous move -> the quiet reply that
+//     refuted it last time
+//   - Continuation history: [previous piece][previous to][piece][to], quiet
+//     move success as a follow-up to the move 1 and 2 plies earlier (one
+//     table serves both distances)
+//
+// On a quiet beta cutoff the cutoff move gets a depth-scaled bonus; every
+// quiet move searched before it gets the same malus in the continuation
+// tables (butterfly history only collects bonuses). Updates use a "gravity"
+// formula that pulls entries back towards zero as they grow, so the values
+// stay within +-HISTORY_MAX without periodic aging.
+//
+// Each search thread owns its tables (see ThreadData).
+//
+// =============================================================================
+
+#include "types.hpp"
+#include "tune.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace Search {
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+constexpr int HISTORY_MAX = 16384;         // Entry bound (int16_t)
+TUNABLE(HISTORY_BONUS_SCALE, 32, 4, 128);  // Bonus = min(MAX_BONUS, SCALE * depth^2)
+TUNABLE(HISTORY_MAX_BONUS, 1600, 200, 4000);
+
+// =============================================================================
+// Tables
+// =============================================================================
+
+using ButterflyHistory = int16_t[2][64][64];        // [side][from][to]
+using PieceToHistory = int16_t[12][64];             // [piece][to]
+using ContinuationHistory = PieceToHistory[12][64]; // [previous piece][previous to]
+using CounterMoveTable = Move[12][64];              // [previous piece][previous to]
+
+inline int history_bonus(int depth) {
+    return std::min(HISTORY_MAX_BONUS, HISTORY_BONUS_SCALE * depth * depth);
+}
+
+// Gravity update: the larger the entry, the less a same-signed bonus adds
+inline void update_history_entry(int16_t& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+// =============================================================================
+// Quiet Ordering Context
+// =============================================================================
+
+// What the picker's quiet stages need from the search at one node
+struct QuietOrdering {
+    Move killers[2] = {};
+    Move counter_move = 0;
+    const ButterflyHistory* butterfly = nullptr;
+    const PieceToHistory* continuation[2] = {};     // 1 and 2 plies back (nullptr: none)
+
+    // Combined history score of a quiet move (higher = better)
+    int score(const int board[64], int side, Move move) const {
+        int source = get_move_source(move);
+        int target = get_move_target(move);
+        int piece = board[source];
+        int total = 0;
+
+        if (butterfly) total += (*butterfly)[side][source][target];
+        for (const PieceToHistory* cont : continuation) {
+            if (cont) total += (*cont)[piece][target];
+        }
+        return total;
+    }
+};
+
+} // namespace Search
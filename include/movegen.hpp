@@ -5,349 +5,553 @@
 // =============================================================================
 
 #include "position.hpp"
+#include "tt.hpp"
+#include <cassert>
+#include <cstdlib>
 
 // =============================================================================
-// Move Generation
+// Move Generation (Fully Legal)
+// =============================================================================
+//
+// Checkers and pinned pieces are computed once per call:
+// - Double check: only king moves are generated
+// - Single check: other pieces may only capture the checker or block on
+//   the squares between it and the king
+// - Pinned pieces may only move along the line through their king
+// - King moves are tested with the king removed from the occupancy, so
+//   sliders see through the square it is leaving
+// - En passant is verified by replaying the capture on the occupancy
+//   (covers the horizontal discovered check through both pawns)
+//
+// move_type selects ALL_MOVES, ONLY_CAPTURES (captures, capture-promotions,
+// en passant) or ONLY_QUIETS (everything else, including castling).
+//
 // =============================================================================
 
-inline void Position::generate_moves(MoveList& moves) const {
+inline void Position::generate_moves(MoveList& moves, int move_type) const {
     moves.count = 0;
     
     int source, target;
-    int enemy_king = (side == WHITE) ? k : K;
+    int us = side;
+    int them = side ^ 1;
+    int pawn = (us == WHITE) ? P : p;
+    int knight = (us == WHITE) ? N : n;
+    int bishop = (us == WHITE) ? B : b;
+    int rook = (us == WHITE) ? R : r;
+    int queen = (us == WHITE) ? Q : q;
+    int king = (us == WHITE) ? K : k;
     U64 bb, attacks;
     
-    for (int piece = P; piece <= k; piece++) {
-        bb = piece_bitboards[piece];
+    int king_sq = get_ls1b_index(piece_bitboards[king]);
+    U64 checkers = checkers_to_king(king_sq, us);
+    U64 pinned = pinned_pieces(king_sq, us);
+    bool double_check = checkers && (checkers & (checkers - 1));
+    
+    // Target squares allowed by the requested move type
+    U64 type_mask = (move_type == ONLY_CAPTURES) ? occupancy[them] :
+                    (move_type == ONLY_QUIETS)   ? ~occupancy[BOTH] : ~occupancy[us];
+    
+    // Squares non-king pieces may move to (block or capture the checker when in check)
+    U64 target_mask = type_mask;
+    if (checkers) {
+        int checker_sq = get_ls1b_index(checkers);
+        target_mask &= between_masks[king_sq][checker_sq] | checkers;
+    }
+    
+    if (!double_check) {
+        // Pawns
+        int push = (us == WHITE) ? -8 : 8;
+        U64 promotion_rank = (us == WHITE) ? 0xFF00ULL : 0xFF000000000000ULL;        // rank 7 / rank 2
+        U64 double_rank = (us == WHITE) ? 0xFF000000000000ULL : 0xFF00ULL;           // rank 2 / rank 7
         
-        // White pawns
-        if (side == WHITE && piece == P) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                target = source - 8;
-                
-                // Quiet pawn moves
-                if (target >= a8 && !get_bit(occupancy[BOTH], target)) {
-                    // Promotion
-                    if (source >= a7 && source <= h7) {
-                        moves.add(encode_move(source, target, piece, Q, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, R, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, B, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, N, 0, 0, 0, 0, 0));
+        bb = piece_bitboards[pawn];
+        while (bb) {
+            source = get_ls1b_index(bb);
+            U64 allowed = target_mask;
+            if (pinned & (1ULL << source)) allowed &= line_masks[king_sq][source];
+            bool promotes = (promotion_rank & (1ULL << source)) != 0;
+            
+            // Quiet pawn moves
+            target = source + push;
+            if (!get_bit(occupancy[BOTH], target)) {
+                if (get_bit(allowed, target)) {
+                    if (promotes) {
+                        for (int promo = 3; promo >= 0; promo--)   // Q, R, B, N
+                            moves.add(encode_move(source, target, FLAG_PROMOTION + promo));
                     } else {
-                        // Single push (with check detection)
-                        int is_check = (piece_bitboards[k] & pawn_attacks[WHITE][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 0, 0, 0, 0, is_check));
-                        
-                        // Double push
-                        if (source >= a2 && source <= h2 && !get_bit(occupancy[BOTH], (target - 8))) {
-                            int is_check2 = (piece_bitboards[k] & pawn_attacks[WHITE][target - 8]) ? 1 : 0;
-                            moves.add(encode_move(source, target - 8, piece, 0, 0, 1, 0, 0, is_check2));
-                        }
+                        moves.add(encode_move(source, target, FLAG_QUIET));
                     }
                 }
                 
-                // Pawn captures
-                attacks = pawn_attacks[WHITE][source] & occupancy[BLACK];
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    if (source >= a7 && source <= h7) {
-                        moves.add(encode_move(source, target, piece, Q, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, R, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, B, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, N, 1, 0, 0, 0, 0));
-                    } else {
-                        int is_check = (piece_bitboards[k] & pawn_attacks[WHITE][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 1, 0, 0, 0, is_check));
-                    }
-                    pop_bit(attacks, target);
+                // Double push
+                int target2 = target + push;
+                if ((double_rank & (1ULL << source)) && !get_bit(occupancy[BOTH], target2) &&
+                    get_bit(allowed, target2)) {
+                    moves.add(encode_move(source, target2, FLAG_DOUBLE_PUSH));
                 }
-                
-                // En passant
-                if (enpassant != NO_SQUARE) {
-                    U64 ep_attacks = pawn_attacks[WHITE][source] & (1ULL << enpassant);
-                    if (ep_attacks) {
-                        target = get_ls1b_index(ep_attacks);
-                        int is_check = (piece_bitboards[k] & pawn_attacks[WHITE][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 1, 0, 1, 0, is_check));
-                    }
+            }
+            
+            // Pawn captures
+            attacks = pawn_attacks[us][source] & occupancy[them] & allowed;
+            while (attacks) {
+                target = get_ls1b_index(attacks);
+                if (promotes) {
+                    for (int promo = 3; promo >= 0; promo--)
+                        moves.add(encode_move(source, target, FLAG_PROMO_CAPTURE + promo));
+                } else {
+                    moves.add(encode_move(source, target, FLAG_CAPTURE));
                 }
-                
-                pop_bit(bb, source);
+                pop_bit(attacks, target);
+            }
+            
+            // En passant
+            if (enpassant != NO_SQUARE && move_type != ONLY_QUIETS &&
+                (pawn_attacks[us][source] & (1ULL << enpassant))) {
+                if (is_enpassant_legal(source, king_sq, checkers))
+                    moves.add(encode_move(source, enpassant, FLAG_ENPASSANT));
             }
+            
+            pop_bit(bb, source);
         }
         
-        // Black pawns
-        if (side == BLACK && piece == p) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                target = source + 8;
-                
-                if (target <= h1 && !get_bit(occupancy[BOTH], target)) {
-                    if (source >= a2 && source <= h2) {
-                        moves.add(encode_move(source, target, piece, q, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, r, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, b, 0, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, n, 0, 0, 0, 0, 0));
-                    } else {
-                        int is_check = (piece_bitboards[K] & pawn_attacks[BLACK][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 0, 0, 0, 0, is_check));
-                        
-                        if (source >= a7 && source <= h7 && !get_bit(occupancy[BOTH], (target + 8))) {
-                            int is_check2 = (piece_bitboards[K] & pawn_attacks[BLACK][target + 8]) ? 1 : 0;
-                            moves.add(encode_move(source, target + 8, piece, 0, 0, 1, 0, 0, is_check2));
-                        }
-                    }
-                }
-                
-                attacks = pawn_attacks[BLACK][source] & occupancy[WHITE];
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    if (source >= a2 && source <= h2) {
-                        moves.add(encode_move(source, target, piece, q, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, r, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, b, 1, 0, 0, 0, 0));
-                        moves.add(encode_move(source, target, piece, n, 1, 0, 0, 0, 0));
-                    } else {
-                        int is_check = (piece_bitboards[K] & pawn_attacks[BLACK][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 1, 0, 0, 0, is_check));
-                    }
-                    pop_bit(attacks, target);
-                }
-                
-                if (enpassant != NO_SQUARE) {
-                    U64 ep_attacks = pawn_attacks[BLACK][source] & (1ULL << enpassant);
-                    if (ep_attacks) {
-                        target = get_ls1b_index(ep_attacks);
-                        int is_check = (piece_bitboards[K] & pawn_attacks[BLACK][target]) ? 1 : 0;
-                        moves.add(encode_move(source, target, piece, 0, 1, 0, 1, 0, is_check));
-                    }
-                }
-                
-                pop_bit(bb, source);
-            }
+        // Rooks
+        bb = piece_bitboards[rook];
+        while (bb) {
+            source = get_ls1b_index(bb);
+            attacks = get_rook_attacks(source, occupancy[BOTH]) & target_mask;
+            if (pinned & (1ULL << source)) attacks &= line_masks[king_sq][source];
+            add_piece_moves(moves, source, attacks);
+            pop_bit(bb, source);
         }
         
-        // Castling
-        if (side == WHITE && piece == K) {
-            if (castling & WK) {
-                if (!get_bit(occupancy[BOTH], f1) && !get_bit(occupancy[BOTH], g1)) {
-                    if (!is_square_attacked(e1, BLACK) && !is_square_attacked(f1, BLACK)) {
-                        moves.add(encode_move(e1, g1, piece, 0, 0, 0, 0, 1, 0));
-                    }
-                }
-            }
-            if (castling & WQ) {
-                if (!get_bit(occupancy[BOTH], d1) && !get_bit(occupancy[BOTH], c1) && 
-                    !get_bit(occupancy[BOTH], b1)) {
-                    if (!is_square_attacked(e1, BLACK) && !is_square_attacked(d1, BLACK)) {
-                        moves.add(encode_move(e1, c1, piece, 0, 0, 0, 0, 1, 0));
-                    }
-                }
-            }
+        // Knights (a pinned knight can never move)
+        bb = piece_bitboards[knight] & ~pinned;
+        while (bb) {
+            source = get_ls1b_index(bb);
+            add_piece_moves(moves, source, knight_attacks[source] & target_mask);
+            pop_bit(bb, source);
         }
         
-        if (side == BLACK && piece == k) {
-            if (castling & BK) {
-                if (!get_bit(occupancy[BOTH], f8) && !get_bit(occupancy[BOTH], g8)) {
-                    if (!is_square_attacked(e8, WHITE) && !is_square_attacked(f8, WHITE)) {
-                        moves.add(encode_move(e8, g8, piece, 0, 0, 0, 0, 1, 0));
-                    }
-                }
-            }
-            if (castling & BQ) {
-                if (!get_bit(occupancy[BOTH], d8) && !get_bit(occupancy[BOTH], c8) && 
-                    !get_bit(occupancy[BOTH], b8)) {
-                    if (!is_square_attacked(e8, WHITE) && !is_square_attacked(d8, WHITE)) {
-                        moves.add(encode_move(e8, c8, piece, 0, 0, 0, 0, 1, 0));
-                    }
-                }
-            }
+        // Bishops
+        bb = piece_bitboards[bishop];
+        while (bb) {
+            source = get_ls1b_index(bb);
+            attacks = get_bishop_attacks(source, occupancy[BOTH]) & target_mask;
+            if (pinned & (1ULL << source)) attacks &= line_masks[king_sq][source];
+            add_piece_moves(moves, source, attacks);
+            pop_bit(bb, source);
         }
         
-        // Knights
-        if ((side == WHITE && piece == N) || (side == BLACK && piece == n)) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                attacks = knight_attacks[source] & ~occupancy[side];
-                
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    int is_capture = get_bit(occupancy[side ^ 1], target) ? 1 : 0;
-                    int is_check = (piece_bitboards[enemy_king] & knight_attacks[target]) ? 1 : 0;
-                    moves.add(encode_move(source, target, piece, 0, is_capture, 0, 0, 0, is_check));
-                    pop_bit(attacks, target);
-                }
-                pop_bit(bb, source);
-            }
+        // Queens
+        bb = piece_bitboards[queen];
+        while (bb) {
+            source = get_ls1b_index(bb);
+            attacks = get_queen_attacks(source, occupancy[BOTH]) & target_mask;
+            if (pinned & (1ULL << source)) attacks &= line_masks[king_sq][source];
+            add_piece_moves(moves, source, attacks);
+            pop_bit(bb, source);
         }
         
-        // Bishops
-        if ((side == WHITE && piece == B) || (side == BLACK && piece == b)) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                attacks = get_bishop_attacks(source, occupancy[BOTH]) & ~occupancy[side];
-                
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    int is_capture = get_bit(occupancy[side ^ 1], target) ? 1 : 0;
-                    int is_check = (piece_bitboards[enemy_king] & get_bishop_attacks(target, occupancy[BOTH])) ? 1 : 0;
-                    moves.add(encode_move(source, target, piece, 0, is_capture, 0, 0, 0, is_check));
-                    pop_bit(attacks, target);
+        // Castling (not out of check, through or into an attacked square)
+        if (!checkers && move_type != ONLY_CAPTURES) {
+            if (us == WHITE) {
+                if ((castling & WK) && !get_bit(occupancy[BOTH], f1) && !get_bit(occupancy[BOTH], g1) &&
+                    !is_square_attacked(f1, BLACK) && !is_square_attacked(g1, BLACK)) {
+                    moves.add(encode_move(e1, g1, FLAG_KING_CASTLE));
+                }
+                if ((castling & WQ) && !get_bit(occupancy[BOTH], d1) && !get_bit(occupancy[BOTH], c1) &&
+                    !get_bit(occupancy[BOTH], b1) &&
+                    !is_square_attacked(d1, BLACK) && !is_square_attacked(c1, BLACK)) {
+                    moves.add(encode_move(e1, c1, FLAG_QUEEN_CASTLE));
+                }
+            } else {
+                if ((castling & BK) && !get_bit(occupancy[BOTH], f8) && !get_bit(occupancy[BOTH], g8) &&
+                    !is_square_attacked(f8, WHITE) && !is_square_attacked(g8, WHITE)) {
+                    moves.add(encode_move(e8, g8, FLAG_KING_CASTLE));
+                }
+                if ((castling & BQ) && !get_bit(occupancy[BOTH], d8) && !get_bit(occupancy[BOTH], c8) &&
+                    !get_bit(occupancy[BOTH], b8) &&
+                    !is_square_attacked(d8, WHITE) && !is_square_attacked(c8, WHITE)) {
+                    moves.add(encode_move(e8, c8, FLAG_QUEEN_CASTLE));
                 }
-                pop_bit(bb, source);
             }
         }
+    }
+    
+    // King moves (also the only evasions in double check)
+    U64 occ_without_king = occupancy[BOTH] ^ (1ULL << king_sq);
+    attacks = king_attacks[king_sq] & type_mask;
+    while (attacks) {
+        target = get_ls1b_index(attacks);
+        if (!is_square_attacked(target, them, occ_without_king)) {
+            int flag = get_bit(occupancy[them], target) ? FLAG_CAPTURE : FLAG_QUIET;
+            moves.add(encode_move(king_sq, target, flag));
+        }
+        pop_bit(attacks, target);
+    }
+}
+
+// =============================================================================
+// Move Validation (TT move / killer moves)
+// =============================================================================
+//
+// Moves taken from the TT or the killer table were generated in another
+// position. Before they are tried ahead of generation, check that they are
+// pseudo-legal here (right piece, consistent flags, reachable target) and
+// legal under the same check/pin rules the generator uses.
+//
+// =============================================================================
+
+inline bool Position::is_move_legal(Move move) const {
+    if (move == 0) return false;
+    
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int flags = get_move_flags(move);
+    int piece = board[source];
+    int us = side;
+    int them = side ^ 1;
+    int offset = (us == WHITE) ? 0 : 6;
+    
+    // Our piece must stand on the source square
+    if (piece < P + offset || piece > K + offset) return false;
+    
+    int king_sq = get_ls1b_index(piece_bitboards[K + offset]);
+    
+    // Castling: same conditions as the generator
+    if (get_move_castling(move)) {
+        if (piece != K + offset || is_square_attacked(king_sq, them)) return false;
+        if (us == WHITE) {
+            if (source != e1) return false;
+            if (flags == FLAG_KING_CASTLE)
+                return target == g1 && (castling & WK) && !get_bit(occupancy[BOTH], f1) && !get_bit(occupancy[BOTH], g1) &&
+                       !is_square_attacked(f1, BLACK) && !is_square_attacked(g1, BLACK);
+            return target == c1 && (castling & WQ) && !get_bit(occupancy[BOTH], d1) && !get_bit(occupancy[BOTH], c1) &&
+                   !get_bit(occupancy[BOTH], b1) &&
+                   !is_square_attacked(d1, BLACK) && !is_square_attacked(c1, BLACK);
+        } else {
+            if (source != e8) return false;
+            if (flags == FLAG_KING_CASTLE)
+                return target == g8 && (castling & BK) && !get_bit(occupancy[BOTH], f8) && !get_bit(occupancy[BOTH], g8) &&
+                       !is_square_attacked(f8, WHITE) && !is_square_attacked(g8, WHITE);
+            return target == c8 && (castling & BQ) && !get_bit(occupancy[BOTH], d8) && !get_bit(occupancy[BOTH], c8) &&
+                   !get_bit(occupancy[BOTH], b8) &&
+                   !is_square_attacked(d8, WHITE) && !is_square_attacked(c8, WHITE);
+        }
+    }
+    
+    // Unused flag values (6, 7) never come out of the generator
+    if (flags == 6 || flags == 7) return false;
+    
+    U64 checkers = checkers_to_king(king_sq, us);
+    
+    // En passant
+    if (get_move_enpassant(move)) {
+        return piece == P + offset && target == enpassant &&
+               (pawn_attacks[us][source] & (1ULL << target)) &&
+               is_enpassant_legal(source, king_sq, checkers);
+    }
+    
+    // Capture flag must agree with the target square (kings are never captured)
+    int captured = board[target];
+    if (get_move_capture(move)) {
+        if (captured == NO_PIECE || captured == K + 6 - offset || (captured < 6) == (us == WHITE))
+            return false;
+    } else if (captured != NO_PIECE) {
+        return false;
+    }
+    
+    // Piece movement
+    if (piece == P + offset) {
+        int push = (us == WHITE) ? -8 : 8;
+        U64 promotion_rank = (us == WHITE) ? 0xFF00ULL : 0xFF000000000000ULL;
+        U64 double_rank = (us == WHITE) ? 0xFF000000000000ULL : 0xFF00ULL;
         
-        // Rooks
-        if ((side == WHITE && piece == R) || (side == BLACK && piece == r)) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                attacks = get_rook_attacks(source, occupancy[BOTH]) & ~occupancy[side];
-                
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    int is_capture = get_bit(occupancy[side ^ 1], target) ? 1 : 0;
-                    int is_check = (piece_bitboards[enemy_king] & get_rook_attacks(target, occupancy[BOTH])) ? 1 : 0;
-                    moves.add(encode_move(source, target, piece, 0, is_capture, 0, 0, 0, is_check));
-                    pop_bit(attacks, target);
-                }
-                pop_bit(bb, source);
-            }
+        bool promotes = (promotion_rank & (1ULL << source)) != 0;
+        if (promotes != (get_move_promotion(move) != 0)) return false;
+        
+        if (get_move_capture(move)) {
+            if (!(pawn_attacks[us][source] & (1ULL << target))) return false;
+        } else if (get_move_doublepawn(move)) {
+            if (!(double_rank & (1ULL << source)) || target != source + 2 * push ||
+                get_bit(occupancy[BOTH], source + push)) return false;
+        } else if (target != source + push) {
+            return false;
         }
+    } else {
+        if (flags != FLAG_QUIET && flags != FLAG_CAPTURE) return false;
         
-        // Queens
-        if ((side == WHITE && piece == Q) || (side == BLACK && piece == q)) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                attacks = get_queen_attacks(source, occupancy[BOTH]) & ~occupancy[side];
-                
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    int is_capture = get_bit(occupancy[side ^ 1], target) ? 1 : 0;
-                    int is_check = (piece_bitboards[enemy_king] & get_queen_attacks(target, occupancy[BOTH])) ? 1 : 0;
-                    moves.add(encode_move(source, target, piece, 0, is_capture, 0, 0, 0, is_check));
-                    pop_bit(attacks, target);
-                }
-                pop_bit(bb, source);
-            }
+        U64 attacks;
+        switch (piece - offset) {
+            case N: attacks = knight_attacks[source]; break;
+            case B: attacks = get_bishop_attacks(source, occupancy[BOTH]); break;
+            case R: attacks = get_rook_attacks(source, occupancy[BOTH]); break;
+            case Q: attacks = get_queen_attacks(source, occupancy[BOTH]); break;
+            default: attacks = king_attacks[source]; break;
         }
+        if (!(attacks & (1ULL << target))) return false;
+    }
+    
+    // Legality: king may not step into an attacked square
+    if (piece == K + offset)
+        return !is_square_attacked(target, them, occupancy[BOTH] ^ (1ULL << source));
+    
+    // Other pieces must resolve a single check and respect pins
+    if (checkers) {
+        if (checkers & (checkers - 1)) return false;
+        int checker_sq = get_ls1b_index(checkers);
+        if (!((between_masks[king_sq][checker_sq] | checkers) & (1ULL << target))) return false;
+    }
+    if (pinned_pieces(king_sq, us) & (1ULL << source))
+        return (line_masks[king_sq][source] & (1ULL << target)) != 0;
+    
+    return true;
+}
+
+// =============================================================================
+// Check Detection
+// =============================================================================
+//
+// Decides whether a move checks the opponent without making it: the moved
+// piece (or promotion piece, or castling rook) is placed on its target in a
+// copy of our slider sets and the occupancy, and the enemy king is tested
+// against that. Sliders uncovered by the move give discovered checks, also
+// through the pawn removed by en passant.
+//
+// =============================================================================
+
+// Rook source/destination for each castling king target
+inline void castling_rook_squares(int king_target, int& rook_from, int& rook_to) {
+    switch (king_target) {
+        case g1: rook_from = h1; rook_to = f1; break;
+        case c1: rook_from = a1; rook_to = d1; break;
+        case g8: rook_from = h8; rook_to = f8; break;
+        default: rook_from = a8; rook_to = d8; break;  // c8
+    }
+}
+
+inline bool Position::gives_check(Move move) const {
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int offset = (side == WHITE) ? 0 : 6;
+    int king_sq = get_ls1b_index(piece_bitboards[side == WHITE ? k : K]);
+    int piece = get_move_promotion(move) ? get_move_promoted(move) : board[source] - offset;
+    
+    U64 from_bb = 1ULL << source;
+    U64 to_bb = 1ULL << target;
+    U64 occ = (occupancy[BOTH] & ~from_bb) | to_bb;
+    U64 bishops_queens = (piece_bitboards[B + offset] | piece_bitboards[Q + offset]) & ~from_bb;
+    U64 rooks_queens = (piece_bitboards[R + offset] | piece_bitboards[Q + offset]) & ~from_bb;
+    
+    if (piece == B || piece == Q) bishops_queens |= to_bb;
+    if (piece == R || piece == Q) rooks_queens |= to_bb;
+    
+    if (get_move_enpassant(move))
+        occ &= ~(1ULL << (side == WHITE ? target + 8 : target - 8));
+    
+    if (get_move_castling(move)) {
+        int rook_from, rook_to;
+        castling_rook_squares(target, rook_from, rook_to);
+        occ = (occ & ~(1ULL << rook_from)) | (1ULL << rook_to);
+        rooks_queens = (rooks_queens & ~(1ULL << rook_from)) | (1ULL << rook_to);
+    }
+    
+    // Direct checks by the leapers
+    if (piece == P && (pawn_attacks[side][target] & (1ULL << king_sq))) return true;
+    if (piece == N && (knight_attacks[target] & (1ULL << king_sq))) return true;
+    
+    // Direct and discovered slider checks
+    return (get_bishop_attacks(king_sq, occ) & bishops_queens) ||
+           (get_rook_attacks(king_sq, occ) & rooks_queens);
+}
+
+// =============================================================================
+// Static Exchange Evaluation
+// =============================================================================
+//
+// Plays out the capture sequence on the target square, each side recapturing
+// with its least valuable attacker, without making any moves. After every
+// capture the attacker leaves the occupancy and the bishop/rook lookups are
+// repeated, which uncovers x-ray attackers (e.g. a rook behind a rook).
+// Pins are ignored. En passant, promotions and castling count as even trades.
+//
+// =============================================================================
+
+// Exchange values indexed by white piece type (king never gets captured)
+constexpr int SEE_VALUES[6] = { 100, 500, 300, 320, 1000, 0 };
+
+inline bool Position::see_ge(Move move, int threshold) const {
+    if (get_move_flags(move) != FLAG_QUIET && get_move_flags(move) != FLAG_CAPTURE &&
+        get_move_flags(move) != FLAG_DOUBLE_PUSH)
+        return threshold <= 0;
+    
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    
+    // Gain if the opponent does not recapture
+    int swap = (board[target] == NO_PIECE ? 0 : SEE_VALUES[board[target] % 6]) - threshold;
+    if (swap < 0) return false;
+    
+    // Loss if the opponent recaptures and we stop there
+    swap = SEE_VALUES[board[source] % 6] - swap;
+    if (swap <= 0) return true;
+    
+    U64 occ = occupancy[BOTH] ^ (1ULL << source) ^ (1ULL << target);
+    U64 attackers = attackers_to(target, occ);
+    U64 bishops_queens = piece_bitboards[B] | piece_bitboards[b] | piece_bitboards[Q] | piece_bitboards[q];
+    U64 rooks_queens = piece_bitboards[R] | piece_bitboards[r] | piece_bitboards[Q] | piece_bitboards[q];
+    int stm = side;
+    int result = 1;
+    
+    while (true) {
+        stm ^= 1;
+        attackers &= occ;
         
-        // Kings
-        if ((side == WHITE && piece == K) || (side == BLACK && piece == k)) {
-            while (bb) {
-                source = get_ls1b_index(bb);
-                attacks = king_attacks[source] & ~occupancy[side];
-                
-                while (attacks) {
-                    target = get_ls1b_index(attacks);
-                    int is_capture = get_bit(occupancy[side ^ 1], target) ? 1 : 0;
-                    moves.add(encode_move(source, target, piece, 0, is_capture, 0, 0, 0, 0));
-                    pop_bit(attacks, target);
-                }
-                pop_bit(bb, source);
-            }
+        U64 stm_attackers = attackers & occupancy[stm];
+        if (!stm_attackers) break;
+        
+        // Side to move takes over: it wins if it can capture and stay ahead
+        result ^= 1;
+        int offset = (stm == WHITE) ? 0 : 6;
+        
+        // Least valuable attacker, in P, N, B, R, Q, K order
+        static constexpr int LVA_ORDER[6] = { P, N, B, R, Q, K };
+        int piece = K;
+        U64 bb = 0ULL;
+        for (int pt : LVA_ORDER) {
+            bb = stm_attackers & piece_bitboards[pt + offset];
+            if (bb) { piece = pt; break; }
         }
+        
+        // The king may only capture if the square is no longer defended
+        if (piece == K)
+            return (attackers & ~occupancy[stm]) ? !result : result;
+        
+        swap = SEE_VALUES[piece] - swap;
+        if (swap < result) break;
+        
+        occ ^= bb & -bb;
+        if (piece == P || piece == B || piece == Q)
+            attackers |= get_bishop_attacks(target, occ) & bishops_queens;
+        if (piece == R || piece == Q)
+            attackers |= get_rook_attacks(target, occ) & rooks_queens;
     }
+    
+    return result;
 }
 
 // =============================================================================
 // Make Move
 // =============================================================================
 
-inline bool Position::make_move(int move, int move_flag) {
+inline bool Position::make_move(Move move, int move_flag) {
     if (move_flag == ALL_MOVES) {
-        // Save state for undo
-        Position backup;
-        copy_to(backup);
-        
         int source = get_move_source(move);
         int target = get_move_target(move);
-        int piece = get_move_piece(move);
-        int promoted = get_move_promoted(move);
+        int piece = board[source];
+        int promoted = get_move_promotion(move) ? get_move_promoted(move) + (side == WHITE ? 0 : 6) : 0;
         int capture = get_move_capture(move);
         int double_push = get_move_doublepawn(move);
         int ep = get_move_enpassant(move);
         int castle_move = get_move_castling(move);
+        int them = side ^ 1;
         
-        // Move the piece
-        pop_bit(piece_bitboards[piece], source);
-        set_bit(piece_bitboards[piece], target);
+        // Save state for undo
+        UndoInfo& undo = undo_stack[undo_ply++];
+        assert(undo_ply <= MAX_GAME_PLY);
+        undo.move = move;
+        undo.captured = NO_PIECE;
+        undo.castling = castling;
+        undo.enpassant = enpassant;
+        undo.rule50 = rule50;
+        undo.plies_from_null = plies_from_null;
+        undo.hash = hash;
         
-        // Handle capture
-        if (capture) {
-            int start_piece = (side == WHITE) ? p : P;
-            int end_piece = (side == WHITE) ? k : K;
-            
-            for (int bb_piece = start_piece; bb_piece <= end_piece; bb_piece++) {
-                if (get_bit(piece_bitboards[bb_piece], target)) {
-                    pop_bit(piece_bitboards[bb_piece], target);
-                    break;
-                }
+        // Halfmove clock: captures and pawn moves are irreversible
+        rule50 = (capture || piece == P || piece == p) ? 0 : rule50 + 1;
+        plies_from_null++;
+        
+        U64 from_to = (1ULL << source) | (1ULL << target);
+        
+        // Handle en passant capture (captured pawn is behind the target square)
+        if (ep) {
+            int captured = (side == WHITE) ? p : P;
+            int capture_square = (side == WHITE) ? target + 8 : target - 8;
+            pop_bit(piece_bitboards[captured], capture_square);
+            pop_bit(occupancy[them], capture_square);
+            hash ^= TT::piece_keys[captured][capture_square];
+            board[capture_square] = NO_PIECE;
+            undo.captured = captured;
+        }
+        // Handle capture (mailbox gives the captured piece directly)
+        else if (capture) {
+            int captured = board[target];
+            if (captured != NO_PIECE) {
+                pop_bit(piece_bitboards[captured], target);
+                pop_bit(occupancy[them], target);
+                hash ^= TT::piece_keys[captured][target];
+                undo.captured = captured;
             }
         }
         
+        // Move the piece
+        piece_bitboards[piece] ^= from_to;
+        occupancy[side] ^= from_to;
+        hash ^= TT::piece_keys[piece][source] ^ TT::piece_keys[piece][target];
+        board[source] = NO_PIECE;
+        board[target] = piece;
+        
         // Handle promotion
         if (promoted) {
-            pop_bit(piece_bitboards[side == WHITE ? P : p], target);
+            pop_bit(piece_bitboards[piece], target);
             set_bit(piece_bitboards[promoted], target);
-        }
-        
-        // Handle en passant capture
-        if (ep) {
-            if (side == WHITE)
-                pop_bit(piece_bitboards[p], target + 8);
-            else
-                pop_bit(piece_bitboards[P], target - 8);
+            hash ^= TT::piece_keys[piece][target] ^ TT::piece_keys[promoted][target];
+            board[target] = promoted;
         }
         
         // Reset en passant square
+        if (enpassant != NO_SQUARE) hash ^= TT::enpassant_keys[enpassant];
         enpassant = NO_SQUARE;
         
         // Handle double pawn push
         if (double_push) {
             enpassant = (side == WHITE) ? target + 8 : target - 8;
+            hash ^= TT::enpassant_keys[enpassant];
         }
         
         // Handle castling
         if (castle_move) {
-            switch (target) {
-                case g1:
-                    pop_bit(piece_bitboards[R], h1);
-                    set_bit(piece_bitboards[R], f1);
-                    break;
-                case c1:
-                    pop_bit(piece_bitboards[R], a1);
-                    set_bit(piece_bitboards[R], d1);
-                    break;
-                case g8:
-                    pop_bit(piece_bitboards[r], h8);
-                    set_bit(piece_bitboards[r], f8);
-                    break;
-                case c8:
-                    pop_bit(piece_bitboards[r], a8);
-                    set_bit(piece_bitboards[r], d8);
-                    break;
-            }
+            int rook = (side == WHITE) ? R : r;
+            int rook_from, rook_to;
+            castling_rook_squares(target, rook_from, rook_to);
+            
+            U64 rook_from_to = (1ULL << rook_from) | (1ULL << rook_to);
+            piece_bitboards[rook] ^= rook_from_to;
+            occupancy[side] ^= rook_from_to;
+            hash ^= TT::piece_keys[rook][rook_from] ^ TT::piece_keys[rook][rook_to];
+            board[rook_from] = NO_PIECE;
+            board[rook_to] = rook;
         }
         
         // Update castling rights
+        hash ^= TT::castling_keys[castling];
         castling &= CASTLING_RIGHTS[source];
         castling &= CASTLING_RIGHTS[target];
+        hash ^= TT::castling_keys[castling];
         
-        // Update occupancies
-        update_occupancies();
+        // Update occupancies (incrementally above, combined here)
+        occupancy[BOTH] = occupancy[WHITE] | occupancy[BLACK];
         
         // Switch side
         side ^= 1;
+        hash ^= TT::side_key;
         
-        // Check if king is in check (illegal move)
-        int king_square = get_ls1b_index(piece_bitboards[side == WHITE ? k : K]);
-        if (is_square_attacked(king_square, side)) {
-            // Restore state
-            backup.copy_to(*this);
-            return false;
-        }
+        // Moves come from the legal generator: the mover's king is never left in check
+        assert(!is_square_attacked(get_ls1b_index(piece_bitboards[side == WHITE ? k : K]), side));
+        
+        // Debug builds: incremental state must match a full recompute
+        assert(hash == TT::generate_hash_key(*this));
+        assert(mailbox_consistent());
         
         return true;
     }
@@ -359,6 +563,106 @@ inline bool Position::make_move(int move, int move_flag) {
     return false;
 }
 
+// =============================================================================
+// Unmake Move (reverts the last make_move using the undo stack)
+// =============================================================================
+
+inline void Position::unmake_move() {
+    const UndoInfo& undo = undo_stack[--undo_ply];
+    int move = undo.move;
+    
+    side ^= 1;
+    int them = side ^ 1;
+    
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int piece = board[target];
+    
+    // Undo promotion (turn the promoted piece back into a pawn)
+    if (get_move_promotion(move)) {
+        int pawn = (side == WHITE) ? P : p;
+        pop_bit(piece_bitboards[piece], target);
+        set_bit(piece_bitboards[pawn], target);
+        piece = pawn;
+    }
+    
+    // Move the piece back
+    U64 from_to = (1ULL << source) | (1ULL << target);
+    piece_bitboards[piece] ^= from_to;
+    occupancy[side] ^= from_to;
+    board[source] = piece;
+    board[target] = NO_PIECE;
+    
+    // Move the castling rook back
+    if (get_move_castling(move)) {
+        int rook = (side == WHITE) ? R : r;
+        int rook_from, rook_to;
+        castling_rook_squares(target, rook_from, rook_to);
+        
+        U64 rook_from_to = (1ULL << rook_from) | (1ULL << rook_to);
+        piece_bitboards[rook] ^= rook_from_to;
+        occupancy[side] ^= rook_from_to;
+        board[rook_to] = NO_PIECE;
+        board[rook_from] = rook;
+    }
+    
+    // Restore the captured piece
+    if (undo.captured != NO_PIECE) {
+        int capture_square = target;
+        if (get_move_enpassant(move))
+            capture_square = (side == WHITE) ? target + 8 : target - 8;
+        
+        set_bit(piece_bitboards[undo.captured], capture_square);
+        set_bit(occupancy[them], capture_square);
+        board[capture_square] = undo.captured;
+    }
+    
+    occupancy[BOTH] = occupancy[WHITE] | occupancy[BLACK];
+    
+    castling = undo.castling;
+    enpassant = undo.enpassant;
+    rule50 = undo.rule50;
+    plies_from_null = undo.plies_from_null;
+    hash = undo.hash;
+}
+
+// =============================================================================
+// Null Move (pass the turn; used by null move pruning)
+// =============================================================================
+
+// Only side, en passant and hash change; bitboards and mailbox are untouched
+inline void Position::make_null_move() {
+    UndoInfo& undo = undo_stack[undo_ply++];
+    assert(undo_ply <= MAX_GAME_PLY);
+    undo.move = 0;
+    undo.captured = NO_PIECE;
+    undo.castling = castling;
+    undo.enpassant = enpassant;
+    undo.rule50 = rule50;
+    undo.plies_from_null = plies_from_null;
+    undo.hash = hash;
+    
+    rule50++;
+    plies_from_null = 0;
+    side ^= 1;
+    hash ^= TT::side_key;
+    if (enpassant != NO_SQUARE) {
+        hash ^= TT::enpassant_keys[enpassant];
+        enpassant = NO_SQUARE;
+    }
+    
+    assert(hash == TT::generate_hash_key(*this));
+}
+
+inline void Position::unmake_null_move() {
+    const UndoInfo& undo = undo_stack[--undo_ply];
+    side ^= 1;
+    enpassant = undo.enpassant;
+    rule50 = undo.rule50;
+    plies_from_null = undo.plies_from_null;
+    hash = undo.hash;
+}
+
 // =============================================================================
 // FEN Parsing
 // =============================================================================
@@ -366,9 +670,13 @@ inline bool Position::make_move(int move, int move_flag) {
 inline void Position::parse_fen(const char* fen) {
     std::memset(piece_bitboards, 0, sizeof(piece_bitboards));
     std::memset(occupancy, 0, sizeof(occupancy));
+    for (int square = 0; square < 64; square++) board[square] = NO_PIECE;
     side = WHITE;
     enpassant = NO_SQUARE;
     castling = 0;
+    rule50 = 0;
+    plies_from_null = 0;
+    undo_ply = 0;
     
     for (int rank = 0; rank < 8; rank++) {
         for (int file = 0; file < 8; file++) {
@@ -376,23 +684,17 @@ inline void Position::parse_fen(const char* fen) {
             
             if ((*fen >= 'a' && *fen <= 'z') || (*fen >= 'A' && *fen <= 'Z')) {
                 int piece = char_to_piece(*fen);
-                if (piece != NO_PIECE)
+                if (piece != NO_PIECE) {
                     set_bit(piece_bitboards[piece], square);
+                    board[square] = piece;
+                }
                 fen++;
             }
             
             if (*fen >= '0' && *fen <= '9') {
                 int offset = *fen - '0';
-                int found_piece = -1;
                 
-                for (int p = P; p <= k; p++) {
-                    if (get_bit(piece_bitboards[p], square)) {
-                        found_piece = p;
-                        break;
-                    }
-                }
-                
-                if (found_piece == -1) file--;
+                if (board[square] == NO_PIECE) file--;
                 file += offset;
                 fen++;
             }
@@ -422,5 +724,14 @@ inline void Position::parse_fen(const char* fen) {
         enpassant = rank * 8 + file;
     }
     
+    // Halfmove clock (optional: EPD-style FENs end after the en passant field)
+    while (*fen && *fen != ' ') fen++;
+    while (*fen == ' ') fen++;
+    if (*fen >= '0' && *fen <= '9') {
+        rule50 = std::atoi(fen);
+        plies_from_null = rule50;
+    }
+    
     update_occupancies();
+    hash = TT::generate_hash_key(*this);
 }
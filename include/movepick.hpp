@@ -0,0 +1,212 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Staged Move Picker
+// =============================================================================
+//
+// Yields moves one at a time in stages, generating each group only when the
+// previous one is exhausted without a cutoff:
+//   1. TT move (validated, before any generation)
+//   2. Winning and equal captures (MVV-LVA, SEE >= 0)
+//   3. Killer moves (validated)
+//   4. Countermove: the quiet reply that refuted the previous move (validated)
+//   5. Quiet moves (queen promotions first, then by history, see history.hpp)
+//   6. Losing captures (SEE < 0), deferred from stage 2
+//
+// Within a stage the best remaining move is picked lazily (one O(n) scan
+// per move), so a cutoff never pays for sorting the rest of the list.
+// Quiescence search uses the capture stage only unless in check; there all
+// captures are returned and the caller prunes the losing ones itself.
+//
+// =============================================================================
+
+#include "position.hpp"
+#include "movegen.hpp"
+#include "history.hpp"
+#include <utility>
+
+namespace Search {
+
+// =============================================================================
+// Move Ordering Scores (lower = better, searched first)
+// =============================================================================
+
+constexpr int SCORE_CAPTURE_BASE = -900000; // Captures: -900000 range
+constexpr int SCORE_QUEEN_PROMOTION = -100000; // Quiet queen promotions, ahead of any history
+TUNABLE(SCORE_MVV_WEIGHT, 10, 1, 20);       // MVV-LVA: WEIGHT * victim - attacker
+
+// =============================================================================
+// Helper: Get captured piece at target square (O(1) mailbox lookup)
+// Returns piece type (0-11) or NO_PIECE if no capture
+// =============================================================================
+inline int get_captured_piece(const Position& pos, int target_sq) {
+    return pos.board[target_sq];
+}
+
+// Get absolute piece value (for captures/delta pruning)
+inline int get_piece_value_abs(int piece) {
+    // PIECE_VALUES has negative values for black pieces, take absolute
+    return (PIECE_VALUES[piece] < 0) ? -PIECE_VALUES[piece] : PIECE_VALUES[piece];
+}
+
+// =============================================================================
+// Move Picker
+// =============================================================================
+
+enum PickerStage {
+    STAGE_TT_MOVE,
+    STAGE_INIT_CAPTURES,
+    STAGE_CAPTURES,
+    STAGE_KILLER_1,
+    STAGE_KILLER_2,
+    STAGE_COUNTER_MOVE,
+    STAGE_INIT_QUIETS,
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,
+    STAGE_DONE
+};
+
+class MovePicker {
+public:
+    // captures_only: quiescence mode (capture stage only; TT move only if a capture)
+    MovePicker(const Position& pos, Move tt_move, const QuietOrdering& quiet, bool captures_only)
+        : pos(pos), quiet(quiet), stage(STAGE_TT_MOVE), index(0), bad_count(0), bad_index(0),
+          captures_only(captures_only) {
+        this->tt_move = (tt_move && (!captures_only || get_move_capture(tt_move)) &&
+                         pos.is_move_legal(tt_move)) ? tt_move : 0;
+        counter_move = (quiet.counter_move != quiet.killers[0] &&
+                        quiet.counter_move != quiet.killers[1]) ? quiet.counter_move : 0;
+    }
+
+    // Next move to search, or 0 when all stages are exhausted
+    Move next_move() {
+        switch (stage) {
+            case STAGE_TT_MOVE:
+                stage = STAGE_INIT_CAPTURES;
+                if (tt_move) return tt_move;
+                // fallthrough
+
+            case STAGE_INIT_CAPTURES:
+                pos.generate_moves(moves, ONLY_CAPTURES);
+                score_captures();
+                index = 0;
+                stage = STAGE_CAPTURES;
+                // fallthrough
+
+            case STAGE_CAPTURES:
+                while (index < moves.count) {
+                    Move move = pick_next();
+                    if (move == tt_move) continue;
+                    if (!captures_only && !pos.see_ge(move, 0)) {
+                        bad_captures[bad_count++] = move;
+                        continue;
+                    }
+                    return move;
+                }
+                if (captures_only) {
+                    stage = STAGE_DONE;
+                    return 0;
+                }
+                stage = STAGE_KILLER_1;
+                // fallthrough
+
+            case STAGE_KILLER_1:
+                stage = STAGE_KILLER_2;
+                if (is_valid_quiet(quiet.killers[0])) return quiet.killers[0];
+                // fallthrough
+
+            case STAGE_KILLER_2:
+                stage = STAGE_COUNTER_MOVE;
+                if (quiet.killers[1] != quiet.killers[0] && is_valid_quiet(quiet.killers[1]))
+                    return quiet.killers[1];
+                // fallthrough
+
+            case STAGE_COUNTER_MOVE:
+                stage = STAGE_INIT_QUIETS;
+                if (is_valid_quiet(counter_move)) return counter_move;
+                // fallthrough
+
+            case STAGE_INIT_QUIETS:
+                pos.generate_moves(moves, ONLY_QUIETS);
+                score_quiets();
+                index = 0;
+                stage = STAGE_QUIETS;
+                // fallthrough
+
+            case STAGE_QUIETS:
+                while (index < moves.count) {
+                    Move move = pick_next();
+                    if (move != tt_move && move != quiet.killers[0] &&
+                        move != quiet.killers[1] && move != counter_move) return move;
+                }
+                stage = STAGE_BAD_CAPTURES;
+                // fallthrough
+
+            case STAGE_BAD_CAPTURES:
+                if (bad_index < bad_count) return bad_captures[bad_index++];
+                stage = STAGE_DONE;
+                // fallthrough
+
+            case STAGE_DONE:
+            default:
+                return 0;
+        }
+    }
+
+private:
+    const Position& pos;
+    QuietOrdering quiet;
+    MoveList moves;
+    int stage;
+    int index;
+    Move bad_captures[MAX_MOVES];   // Losing captures, in MVV-LVA order
+    int bad_count;
+    int bad_index;
+    bool captures_only;
+    Move tt_move;
+    Move counter_move;              // 0 if it repeats a killer
+
+    // Killers and countermoves come from other nodes: must not repeat the TT move
+    bool is_valid_quiet(Move move) const {
+        return move && move != tt_move && !get_move_capture(move) && pos.is_move_legal(move);
+    }
+
+    // Swap the best remaining move (lowest score) to 'index' and return it
+    Move pick_next() {
+        int best_idx = index;
+        for (int i = index + 1; i < moves.count; i++) {
+            if (moves.moves[i].score < moves.moves[best_idx].score)
+                best_idx = i;
+        }
+
+        if (best_idx != index)
+            std::swap(moves.moves[index], moves.moves[best_idx]);
+        return moves.moves[index++].move;
+    }
+
+    // MVV-LVA: prioritize capturing high-value pieces with low-value pieces
+    void score_captures() {
+        for (int i = 0; i < moves.count; i++) {
+            Move move = moves.moves[i].move;
+            int target_piece = get_captured_piece(pos, get_move_target(move));
+            if (target_piece == NO_PIECE) target_piece = P;  // En passant
+
+            int victim_value = get_piece_value_abs(target_piece);
+            int attacker_value = get_piece_value_abs(pos.board[get_move_source(move)]);
+            moves.moves[i].score = SCORE_CAPTURE_BASE + (SCORE_MVV_WEIGHT * victim_value - attacker_value);
+        }
+    }
+
+    void score_quiets() {
+        for (int i = 0; i < moves.count; i++) {
+            Move move = moves.moves[i].move;
+            if (get_move_promoted(move) == Q) {
+                moves.moves[i].score = SCORE_QUEEN_PROMOTION;
+                continue;
+            }
+            moves.moves[i].score = -quiet.score(pos.board, pos.side, move);
+        }
+    }
+};
+
+} // namespace Search
@@ -0,0 +1,321 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Perft (Move Generation Verification)
+// =============================================================================
+//
+// Counts the leaves of the legal move tree to a fixed depth. Used both as a
+// correctness check for move generation and as a throughput benchmark.
+// Features:
+// - Bulk counting at the last ply (no recursion into leaf positions)
+// - Zobrist-keyed perft table caching subtree counts
+// - Root moves split across worker threads
+// - Optional batched depth-2 counting with the 4-lane kernel (batchgen.hpp)
+// - Reference suite with known node counts
+//
+// =============================================================================
+
+#include "position.hpp"
+#include "movegen.hpp"
+#include "tt.hpp"
+#include "batchgen.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Perft {
+
+// =============================================================================
+// Perft Hash Table
+// =============================================================================
+
+// 2^20 entries = 16MB (each entry is two 64-bit words)
+constexpr int PERFT_TABLE_BITS = 20;
+constexpr int PERFT_TABLE_SIZE = 1 << PERFT_TABLE_BITS;
+constexpr int PERFT_TABLE_MASK = PERFT_TABLE_SIZE - 1;
+
+// Lockless entry shared by all perft threads.
+// The key is stored XORed with the data word, so a torn write from another
+// thread fails verification instead of returning a wrong count.
+struct PerftEntry {
+    std::atomic<U64> key_xor_data;
+    std::atomic<U64> data;          // (nodes << 8) | depth
+};
+
+inline PerftEntry perft_table[PERFT_TABLE_SIZE];
+
+inline void clear_table() {
+    for (int i = 0; i < PERFT_TABLE_SIZE; i++) {
+        perft_table[i].key_xor_data.store(0, std::memory_order_relaxed);
+        perft_table[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline bool probe(U64 key, int depth, U64& nodes) {
+    PerftEntry& entry = perft_table[key & PERFT_TABLE_MASK];
+    U64 data = entry.data.load(std::memory_order_relaxed);
+    U64 check = entry.key_xor_data.load(std::memory_order_relaxed);
+
+    if ((check ^ data) != key || static_cast<int>(data & 0xff) != depth)
+        return false;
+
+    nodes = data >> 8;
+    return true;
+}
+
+inline void store(U64 key, int depth, U64 nodes) {
+    PerftEntry& entry = perft_table[key & PERFT_TABLE_MASK];
+    U64 data = (nodes << 8) | static_cast<U64>(depth);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+}
+
+// =============================================================================
+// Perft Core
+// =============================================================================
+
+// Depth 2 with the batched kernel: children are counted four at a time.
+// Lanes the kernel cannot count exactly (check, pins, en passant) are
+// replayed through generate_moves.
+inline U64 perft_batched_depth2(Position& pos) {
+    MoveList moves;
+    pos.generate_moves(moves);
+
+    BatchGen::Batch batch;
+    BatchGen::LaneResult results[BatchGen::LANES];
+    Move lane_moves[BatchGen::LANES];
+    U64 nodes = 0;
+
+    for (int start = 0; start < moves.count; start += BatchGen::LANES) {
+        int lanes = std::min(BatchGen::LANES, moves.count - start);
+        if (lanes < BatchGen::LANES) batch.clear();
+
+        for (int lane = 0; lane < lanes; lane++) {
+            lane_moves[lane] = moves.moves[start + lane].move;
+            pos.make_move(lane_moves[lane], ALL_MOVES);
+            batch.set(lane, pos);
+            pos.unmake_move();
+        }
+
+        BatchGen::count_moves(batch, results);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            if (results[lane].exact) {
+                nodes += results[lane].moves;
+            } else {
+                MoveList replies;
+                pos.make_move(lane_moves[lane], ALL_MOVES);
+                pos.generate_moves(replies);
+                pos.unmake_move();
+                nodes += replies.count;
+            }
+        }
+    }
+
+    return nodes;
+}
+
+inline U64 perft(Position& pos, int depth, bool use_hash, bool batched = false) {
+    if (depth == 0) return 1;
+
+    U64 hash_key = 0;
+    if (use_hash && depth >= 2) {
+        U64 cached;
+        hash_key = pos.hash;
+        if (probe(hash_key, depth, cached)) return cached;
+    }
+
+    if (batched && depth == 2) {
+        U64 nodes = perft_batched_depth2(pos);
+        if (use_hash) store(hash_key, depth, nodes);
+        return nodes;
+    }
+
+    MoveList moves;
+    pos.generate_moves(moves);
+
+    // Bulk counting: the generator is fully legal, so the leaf count at
+    // the last ply is just the size of the move list
+    if (depth == 1) return moves.count;
+
+    U64 nodes = 0;
+    for (int i = 0; i < moves.count; i++) {
+        pos.make_move(moves.moves[i].move, ALL_MOVES);
+        nodes += perft(pos, depth - 1, use_hash, batched);
+        pos.unmake_move();
+    }
+
+    if (use_hash && depth >= 2) store(hash_key, depth, nodes);
+
+    return nodes;
+}
+
+// =============================================================================
+// Root Split (Divide + Multithreading)
+// =============================================================================
+
+struct RootCount {
+    Move move;
+    U64 nodes;
+};
+
+// Count each root move's subtree; root moves are handed out to worker
+// threads one at a time so uneven subtrees still balance across threads
+inline std::vector<RootCount> perft_root(Position& pos, int depth, int num_threads, bool use_hash,
+                                         bool batched = false) {
+    MoveList moves;
+    pos.generate_moves(moves);
+
+    std::vector<RootCount> results(moves.count);
+    std::atomic<int> next_move(0);
+
+    auto worker = [&]() {
+        // Heap-allocated: Position carries a full undo stack
+        std::unique_ptr<Position> local(new Position());
+        pos.copy_to(*local);
+
+        while (true) {
+            int i = next_move.fetch_add(1);
+            if (i >= moves.count) break;
+
+            results[i].move = moves.moves[i].move;
+            local->make_move(moves.moves[i].move, ALL_MOVES);
+            results[i].nodes = perft(*local, depth - 1, use_hash, batched);
+            local->unmake_move();
+        }
+    };
+
+    num_threads = std::max(1, std::min(num_threads, moves.count));
+
+    if (num_threads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++)
+            threads.emplace_back(worker);
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    return results;
+}
+
+inline U64 run(Position& pos, int depth, int num_threads, bool divide, bool use_hash = true,
+               bool batched = false) {
+    if (depth < 1) depth = 1;
+    if (use_hash) clear_table();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<RootCount> results = perft_root(pos, depth, num_threads, use_hash, batched);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    U64 total = 0;
+    for (const RootCount& result : results) {
+        total += result.nodes;
+
+        if (divide) {
+            std::cout << SQUARE_TO_COORD[get_move_source(result.move)]
+                      << SQUARE_TO_COORD[get_move_target(result.move)];
+            if (get_move_promoted(result.move))
+                std::cout << promoted_to_char(get_move_promoted(result.move));
+            std::cout << ": " << result.nodes << std::endl;
+        }
+    }
+
+    if (divide) std::cout << std::endl;
+    std::cout << "Nodes: " << total << "  Time: " << ms << " ms";
+    if (ms > 0) std::cout << "  NPS: " << (total * 1000 / ms);
+    std::cout << std::endl;
+
+    return total;
+}
+
+// =============================================================================
+// Reference Suite
+// =============================================================================
+
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    int default_depth;
+    U64 expected[7];    // expected[depth], 0 = unknown
+};
+
+inline const PerftCase PERFT_SUITE[] = {
+    { "Starting Position", START_POSITION,    5,
+      { 0, 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "Kiwipete",          KIWIPETE_POSITION, 4,
+      { 0, 48, 2039, 97862, 4085603, 193690690, 0 } },
+    { "Position 3",        PERFT_POSITION_3,  5,
+      { 0, 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "Position 4",        PERFT_POSITION_4,  4,
+      { 0, 6, 264, 9467, 422333, 15833292, 706045033 } },
+    { "Position 5",        PERFT_POSITION_5,  4,
+      { 0, 44, 1486, 62379, 2103487, 89941194, 0 } },
+    { "Position 6",        PERFT_POSITION_6,  4,
+      { 0, 46, 2079, 89890, 3894594, 164075551, 0 } }
+};
+
+// Run every suite position; depth_override > 0 replaces the default depth
+// (positions without a known count at that depth are skipped)
+inline bool run_suite(Position& pos, int depth_override, int num_threads, bool use_hash = true,
+                      bool batched = false) {
+    std::cout << "\n=== BATU PERFT SUITE ===" << std::endl;
+    std::cout << "Threads: " << num_threads << (use_hash ? "" : ", no hash")
+              << (batched ? ", batched kernel" : "") << "\n" << std::endl;
+
+    std::cout << "| Position             | Depth | Time(ms) | Nodes        | Expected     | NPS        | Status |" << std::endl;
+    std::cout << "|----------------------|-------|----------|--------------|--------------|------------|--------|" << std::endl;
+
+    U64 total_nodes = 0;
+    long long total_time = 0;
+    int passed = 0;
+    int run_count = 0;
+
+    for (const PerftCase& test : PERFT_SUITE) {
+        int depth = depth_override > 0 ? depth_override : test.default_depth;
+        if (depth > 6 || test.expected[depth] == 0) continue;
+
+        pos.parse_fen(test.fen);
+        if (use_hash) clear_table();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<RootCount> results = perft_root(pos, depth, num_threads, use_hash, batched);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+        U64 nodes = 0;
+        for (const RootCount& result : results)
+            nodes += result.nodes;
+
+        bool ok = (nodes == test.expected[depth]);
+        if (ok) passed++;
+        run_count++;
+        total_nodes += nodes;
+        total_time += ms;
+
+        std::printf("| %-20s | %5d | %8lld | %12llu | %12llu | %10llu | %s |\n",
+            test.name, depth, (long long)ms, (unsigned long long)nodes,
+            (unsigned long long)test.expected[depth],
+            (unsigned long long)(ms > 0 ? nodes * 1000 / ms : 0),
+            ok ? "PASS" : "FAIL");
+    }
+
+    std::cout << "|----------------------|-------|----------|--------------|--------------|------------|--------|" << std::endl;
+    std::cout << "\nSummary: " << passed << "/" << run_count << " passed";
+    std::cout << ", Total: " << total_time << " ms, " << total_nodes << " nodes";
+    if (total_time > 0) {
+        std::cout << ", " << (total_nodes * 1000 / total_time) << " nps";
+    }
+    std::cout << std::endl;
+
+    return passed == run_count;
+}
+
+} // namespace Perft
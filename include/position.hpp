@@ -6,9 +6,21 @@
 
 #include "types.hpp"
 #include "magic_numbers.hpp"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define BATU_PEXT_AVAILABLE 1
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#include <intrin.h>
+#define BATU_PEXT_AVAILABLE 1
+#else
+#define BATU_PEXT_AVAILABLE 0
+#endif
+
 // =============================================================================
 // Attack Tables (Global - Initialized Once)
 // =============================================================================
@@ -16,10 +28,74 @@
 inline U64 pawn_attacks[2][64];
 inline U64 knight_attacks[64];
 inline U64 king_attacks[64];
-inline U64 bishop_masks[64];
-inline U64 rook_masks[64];
-inline U64 bishop_attacks[64][512];
-inline U64 rook_attacks[64][4096];
+inline U64 between_masks[64][64];   // Squares strictly between two aligned squares
+inline U64 line_masks[64][64];      // Full line through two aligned squares (0 if not aligned)
+
+// =============================================================================
+// Slider Attack Tables
+// =============================================================================
+//
+// Rook and bishop attacks share one packed table. Each square owns a slice
+// sized to its own number of relevant occupancies ("fancy" magics) rather
+// than the worst case, which shrinks the old fixed [64][4096] + [64][512]
+// arrays (~2.3 MB) to ~840 KB. A slice is indexed either by a magic multiply
+// or, on CPUs with fast BMI2, by PEXT of the occupancy under the mask; the
+// backend is chosen once in AttackTables::init_all().
+//
+// =============================================================================
+
+constexpr int ROOK_TABLE_SIZE = 102400;     // Sum of 2^ROOK_RELEVANT_BITS
+constexpr int BISHOP_TABLE_SIZE = 5248;     // Sum of 2^BISHOP_RELEVANT_BITS
+constexpr int SLIDER_TABLE_SIZE = ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE;
+
+enum SliderBackend { SLIDER_MAGIC, SLIDER_PEXT };
+
+struct SliderMagic {
+    U64 mask;       // Relevant occupancy (board edges excluded)
+    U64 magic;      // Multiplier (magic backend only)
+    U64* attacks;   // This square's slice of slider_attack_table
+    int shift;      // 64 - relevant bits (magic backend only)
+};
+
+inline U64 slider_attack_table[SLIDER_TABLE_SIZE];
+inline SliderMagic rook_magics[64];
+inline SliderMagic bishop_magics[64];
+inline int slider_backend = SLIDER_MAGIC;
+
+#if BATU_PEXT_AVAILABLE && !defined(_MSC_VER)
+// Compiled for BMI2 regardless of -march; only called once cpuid confirmed it
+__attribute__((target("bmi2"))) inline U64 pext_u64(U64 src, U64 mask) {
+    return _pext_u64(src, mask);
+}
+#elif BATU_PEXT_AVAILABLE
+inline U64 pext_u64(U64 src, U64 mask) {
+    return _pext_u64(src, mask);
+}
+#else
+inline U64 pext_u64(U64, U64) {
+    return 0ULL;
+}
+#endif
+
+inline unsigned slider_index(const SliderMagic& m, U64 occ) {
+    if (slider_backend == SLIDER_PEXT)
+        return static_cast<unsigned>(pext_u64(occ, m.mask));
+    return static_cast<unsigned>(((occ & m.mask) * m.magic) >> m.shift);
+}
+
+// =============================================================================
+// Undo Information (pushed by make_move, popped by unmake_move)
+// =============================================================================
+
+struct UndoInfo {
+    Move move;
+    int captured;   // Captured piece (NO_PIECE if none)
+    int castling;
+    int enpassant;
+    int rule50;
+    int plies_from_null;
+    U64 hash;       // Key before the move: the stack doubles as the repetition history
+};
 
 // =============================================================================
 // Position Class - Encapsulates All Game State
@@ -31,10 +107,22 @@ public:
     U64 piece_bitboards[12];
     U64 occupancy[3];  // WHITE, BLACK, BOTH
     
+    // Mailbox: piece on each square (NO_PIECE if empty), kept in sync with bitboards
+    int board[64];
+    
     // Game state
     int side;
     int enpassant;
     int castling;
+    int rule50;             // Halfmove clock: plies since the last capture or pawn move
+    int plies_from_null;    // Plies since the last null move (repetitions cannot cross one)
+    
+    // Zobrist key, maintained incrementally by make_move
+    U64 hash;
+    
+    // Undo stack (each thread searches its own Position, so the stack is per-thread)
+    UndoInfo undo_stack[MAX_GAME_PLY];
+    int undo_ply;
     
     // Search statistics
     long nodes;
@@ -43,9 +131,11 @@ public:
     // Constructors
     // ==========================================================================
     
-    Position() : side(WHITE), enpassant(NO_SQUARE), castling(0), nodes(0) {
+    Position() : side(WHITE), enpassant(NO_SQUARE), castling(0), rule50(0), plies_from_null(0),
+                 hash(0ULL), undo_ply(0), nodes(0) {
         std::memset(piece_bitboards, 0, sizeof(piece_bitboards));
         std::memset(occupancy, 0, sizeof(occupancy));
+        for (int square = 0; square < 64; square++) board[square] = NO_PIECE;
     }
     
     // ==========================================================================
@@ -55,9 +145,17 @@ public:
     void copy_to(Position& dest) const {
         std::memcpy(dest.piece_bitboards, piece_bitboards, sizeof(piece_bitboards));
         std::memcpy(dest.occupancy, occupancy, sizeof(occupancy));
+        std::memcpy(dest.board, board, sizeof(board));
         dest.side = side;
         dest.enpassant = enpassant;
         dest.castling = castling;
+        dest.rule50 = rule50;
+        dest.plies_from_null = plies_from_null;
+        dest.hash = hash;
+        
+        // Game history, so the copy still sees repetitions of earlier positions
+        std::memcpy(dest.undo_stack, undo_stack, sizeof(UndoInfo) * undo_ply);
+        dest.undo_ply = undo_ply;
     }
     
     void update_occupancies() {
@@ -72,6 +170,18 @@ public:
         occupancy[BOTH] = occupancy[WHITE] | occupancy[BLACK];
     }
     
+    // Debug check: mailbox agrees with the piece bitboards
+    bool mailbox_consistent() const {
+        for (int square = 0; square < 64; square++) {
+            int piece = board[square];
+            for (int pc = P; pc <= k; pc++) {
+                if (get_bit(piece_bitboards[pc], square) != (pc == piece ? 1 : 0))
+                    return false;
+            }
+        }
+        return true;
+    }
+    
     // ==========================================================================
     // Bitboard Utilities
     // ==========================================================================
@@ -96,17 +206,13 @@ public:
     // ==========================================================================
     
     static U64 get_bishop_attacks(int square, U64 occ) {
-        occ &= bishop_masks[square];
-        occ *= BISHOP_MAGIC_NUMBERS[square];
-        occ >>= 64 - BISHOP_RELEVANT_BITS[square];
-        return bishop_attacks[square][occ];
+        const SliderMagic& m = bishop_magics[square];
+        return m.attacks[slider_index(m, occ)];
     }
     
     static U64 get_rook_attacks(int square, U64 occ) {
-        occ &= rook_masks[square];
-        occ *= ROOK_MAGIC_NUMBERS[square];
-        occ >>= 64 - ROOK_RELEVANT_BITS[square];
-        return rook_attacks[square][occ];
+        const SliderMagic& m = rook_magics[square];
+        return m.attacks[slider_index(m, occ)];
     }
     
     static U64 get_queen_attacks(int square, U64 occ) {
@@ -114,6 +220,11 @@ public:
     }
     
     bool is_square_attacked(int square, int attacking_side) const {
+        return is_square_attacked(square, attacking_side, occupancy[BOTH]);
+    }
+    
+    // Variant with explicit occupancy (e.g. king removed when testing its own moves)
+    bool is_square_attacked(int square, int attacking_side, U64 occ) const {
         // Pawn attacks
         if (attacking_side == WHITE) {
             if (pawn_attacks[BLACK][square] & piece_bitboards[P]) return true;
@@ -132,29 +243,156 @@ public:
         // Bishop/Queen attacks
         U64 bishops_queens = piece_bitboards[attacking_side == WHITE ? B : b] |
                             piece_bitboards[attacking_side == WHITE ? Q : q];
-        if (get_bishop_attacks(square, occupancy[BOTH]) & bishops_queens)
+        if (get_bishop_attacks(square, occ) & bishops_queens)
             return true;
         
         // Rook/Queen attacks
         U64 rooks_queens = piece_bitboards[attacking_side == WHITE ? R : r] |
                           piece_bitboards[attacking_side == WHITE ? Q : q];
-        if (get_rook_attacks(square, occupancy[BOTH]) & rooks_queens)
+        if (get_rook_attacks(square, occ) & rooks_queens)
             return true;
         
         return false;
     }
     
+    // Enemy pieces giving check to the king of side 'us' on king_sq
+    U64 checkers_to_king(int king_sq, int us) const {
+        int them = us ^ 1;
+        U64 occ = occupancy[BOTH];
+        int offset = (them == WHITE) ? 0 : 6;
+        
+        return (pawn_attacks[us][king_sq] & piece_bitboards[P + offset]) |
+               (knight_attacks[king_sq] & piece_bitboards[N + offset]) |
+               (get_bishop_attacks(king_sq, occ) & (piece_bitboards[B + offset] | piece_bitboards[Q + offset])) |
+               (get_rook_attacks(king_sq, occ) & (piece_bitboards[R + offset] | piece_bitboards[Q + offset]));
+    }
+    
+    // Pieces of both sides attacking 'square' through occupancy 'occ'
+    U64 attackers_to(int square, U64 occ) const {
+        U64 bishops_queens = piece_bitboards[B] | piece_bitboards[b] | piece_bitboards[Q] | piece_bitboards[q];
+        U64 rooks_queens = piece_bitboards[R] | piece_bitboards[r] | piece_bitboards[Q] | piece_bitboards[q];
+        
+        return (pawn_attacks[BLACK][square] & piece_bitboards[P]) |
+               (pawn_attacks[WHITE][square] & piece_bitboards[p]) |
+               (knight_attacks[square] & (piece_bitboards[N] | piece_bitboards[n])) |
+               (king_attacks[square] & (piece_bitboards[K] | piece_bitboards[k])) |
+               (get_bishop_attacks(square, occ) & bishops_queens) |
+               (get_rook_attacks(square, occ) & rooks_queens);
+    }
+    
+    // Pieces of side 'us' that are the only blocker between their king and an enemy slider
+    U64 pinned_pieces(int king_sq, int us) const {
+        int offset = (us == WHITE) ? 6 : 0;  // enemy piece offset
+        U64 snipers = (get_rook_attacks(king_sq, 0ULL) & (piece_bitboards[R + offset] | piece_bitboards[Q + offset])) |
+                      (get_bishop_attacks(king_sq, 0ULL) & (piece_bitboards[B + offset] | piece_bitboards[Q + offset]));
+        U64 pinned = 0ULL;
+        
+        while (snipers) {
+            int sniper_sq = get_ls1b_index(snipers);
+            U64 blockers = between_masks[king_sq][sniper_sq] & occupancy[BOTH];
+            
+            // Exactly one blocker, and it is ours
+            if (blockers && !(blockers & (blockers - 1)) && (blockers & occupancy[us]))
+                pinned |= blockers;
+            
+            snipers &= snipers - 1;
+        }
+        return pinned;
+    }
+    
+    // En passant by the pawn on 'source': replay the capture on the occupancy
+    // and check that no slider sees the king and no other checker remains
+    bool is_enpassant_legal(int source, int king_sq, U64 checkers) const {
+        int them = side ^ 1;
+        int offset = (them == WHITE) ? 0 : 6;
+        int capture_sq = (side == WHITE) ? enpassant + 8 : enpassant - 8;
+        
+        // A knight check cannot be resolved by en passant
+        if (checkers & ~(1ULL << capture_sq) & (piece_bitboards[N + offset] | piece_bitboards[P + offset]))
+            return false;
+        
+        U64 occ = (occupancy[BOTH] ^ (1ULL << source) ^ (1ULL << capture_sq)) | (1ULL << enpassant);
+        
+        return !(get_bishop_attacks(king_sq, occ) & (piece_bitboards[B + offset] | piece_bitboards[Q + offset])) &&
+               !(get_rook_attacks(king_sq, occ) & (piece_bitboards[R + offset] | piece_bitboards[Q + offset]));
+    }
+    
     // ==========================================================================
     // Move Generation
     // ==========================================================================
     
-    void generate_moves(MoveList& moves) const;
+    void generate_moves(MoveList& moves, int move_type = ALL_MOVES) const;
+    
+    // Validate a move from outside the generator (TT move, killer) in this position
+    bool is_move_legal(Move move) const;
+    
+    // Static exchange evaluation: does 'move' win at least 'threshold' centipawns?
+    bool see_ge(Move move, int threshold = 0) const;
+    
+    // Does a legal 'move' check the opponent (directly or by discovery)?
+    bool gives_check(Move move) const;
+    
+    // Add a move from 'source' to each target square (capture flag taken from the board)
+    void add_piece_moves(MoveList& moves, int source, U64 targets) const {
+        U64 captures = targets & occupancy[side ^ 1];
+        U64 quiets = targets & ~captures;
+        while (captures) {
+            moves.add(encode_move(source, get_ls1b_index(captures), FLAG_CAPTURE));
+            captures &= captures - 1;
+        }
+        while (quiets) {
+            moves.add(encode_move(source, get_ls1b_index(quiets), FLAG_QUIET));
+            quiets &= quiets - 1;
+        }
+    }
+    
+    // ==========================================================================
+    // Make / Unmake Move
+    // ==========================================================================
+    
+    bool make_move(Move move, int move_flag);
+    void unmake_move();
+    void make_null_move();
+    void unmake_null_move();
     
     // ==========================================================================
-    // Make Move
+    // Draw Detection
     // ==========================================================================
     
-    bool make_move(int move, int move_flag);
+    // Fifty-move rule or repetition. 'ply' is the distance from the search
+    // root: one repetition inside the search path is enough, a position from
+    // before the root must have occurred twice (threefold). Only positions
+    // since the last capture, pawn move or null move can repeat, and only
+    // with the same side to move, so the scan is short and steps by two.
+    bool is_draw(int ply) const {
+        if (rule50 >= 100) {
+            // Checkmate on the hundredth ply still counts
+            int king_sq = get_ls1b_index(piece_bitboards[side == WHITE ? K : k]);
+            if (!is_square_attacked(king_sq, side ^ 1)) return true;
+            MoveList moves;
+            generate_moves(moves);
+            return moves.count > 0;
+        }
+        
+        int end = std::min(std::min(rule50, plies_from_null), undo_ply);
+        int count = 0;
+        for (int i = 4; i <= end; i += 2) {
+            if (undo_stack[undo_ply - i].hash == hash && (i < ply || ++count == 2))
+                return true;
+        }
+        return false;
+    }
+    
+    // Drop history no repetition check can reach: is_draw looks back at most
+    // min(rule50, plies_from_null) plies, and not at all from rule50 = 100.
+    // Keeps an arbitrarily long game within the undo stack; the dropped
+    // moves can no longer be unmade.
+    void trim_history() {
+        int keep = std::min(std::min(std::min(rule50, plies_from_null), undo_ply), 100);
+        if (keep == undo_ply) return;
+        std::memmove(undo_stack, undo_stack + (undo_ply - keep), sizeof(UndoInfo) * keep);
+        undo_ply = keep;
+    }
     
     // ==========================================================================
     // FEN Parsing
@@ -188,16 +426,9 @@ public:
             std::cout << " " << (8 - rank) << " ";
             for (int file = 0; file < 8; file++) {
                 int square = rank * 8 + file;
-                int piece = -1;
-                
-                for (int p = P; p <= k; p++) {
-                    if (get_bit(piece_bitboards[p], square)) {
-                        piece = p;
-                        break;
-                    }
-                }
+                int piece = board[square];
                 
-                std::cout << " " << (piece == -1 ? '.' : ASCII_PIECES[piece]) << " ";
+                std::cout << " " << (piece == NO_PIECE ? '.' : ASCII_PIECES[piece]) << " ";
             }
             std::cout << std::endl;
         }
@@ -211,7 +442,7 @@ public:
                   << ((castling & BQ) ? 'q' : '-') << std::endl;
     }
     
-    static void print_move(int move) {
+    static void print_move(Move move) {
         std::cout << SQUARE_TO_COORD[get_move_source(move)]
                   << SQUARE_TO_COORD[get_move_target(move)]
                   << promoted_to_char(get_move_promoted(move));
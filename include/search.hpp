@@ -6,10 +6,20 @@
 
 #include "position.hpp"
 #include "movegen.hpp"
+#include "movepick.hpp"
 #include "nn_eval.hpp"
+#include "evalcache.hpp"
 #include "tt.hpp"
+#include "tune.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 // Forward declaration of UCI option
 extern bool UseNN;
@@ -22,176 +32,267 @@ namespace Search {
 
 constexpr int MAX_QUIESCENCE_DEPTH = 8;
 constexpr int MAX_PLY = 64;
+static_assert(MAX_GAME_PLY > 100 + MAX_PLY, "undo stack must hold the trimmed game history plus a search path");
+constexpr int MAX_THREADS = 256;           // Upper bound of the Threads option
+
+// Tunable parameters (tune.hpp): constexpr unless built with BATU_TUNE
+inline void init_lmr();
 
 // NMP (Null Move Pruning) parameters
-constexpr int NMP_MIN_DEPTH = 3;           // Only try NMP at depth >= 3
-constexpr int NMP_REDUCTION = 3;           // R=3 (search depth - 1 - R)
+TUNABLE(NMP_MIN_DEPTH, 3, 1, 6);           // Only try NMP at depth >= 3
+TUNABLE(NMP_REDUCTION, 3, 1, 6);           // R=3 (search depth - 1 - R)
 
 // LMR (Late Move Reductions) parameters  
-constexpr int LMR_MIN_DEPTH = 3;           // Only reduce at depth >= 3
-constexpr int LMR_MIN_MOVE_COUNT = 4;      // Only reduce move 4 onwards
+TUNABLE(LMR_MIN_DEPTH, 3, 1, 6);           // Only reduce at depth >= 3
+TUNABLE(LMR_MIN_MOVE_COUNT, 4, 1, 10);     // Only reduce move 4 onwards
+TUNABLE(LMR_HISTORY_DIVISOR, 16384, 2048, 65536);  // One ply less (more) reduction per this much history
+
+// Reduction table (init_lmr): R = BASE / 100 + ln(depth) * ln(move count) / (DIVISOR / 100)
+TUNABLE_REBUILD(LMR_BASE, 75, 0, 200, init_lmr);
+TUNABLE_REBUILD(LMR_DIVISOR, 225, 100, 400, init_lmr);
+
+// Forward pruning parameters (non-PV nodes, not in check)
+TUNABLE(RFP_MAX_DEPTH, 6, 0, 10);          // Reverse futility: eval - margin * depth >= beta -> cutoff
+TUNABLE(RFP_MARGIN, 80, 20, 200);          // Per ply (one ply less when improving)
+TUNABLE(RAZOR_MAX_DEPTH, 1, 0, 4);         // Razoring: eval + margin * depth < alpha -> verify with qsearch
+TUNABLE(RAZOR_MARGIN, 300, 100, 600);      // Per ply
+TUNABLE(FUTILITY_MAX_DEPTH, 3, 0, 8);      // Futility: skip quiets when eval + margin <= alpha
+TUNABLE(FUTILITY_BASE, 100, 0, 300);       // Margin = BASE + PER_DEPTH * depth
+TUNABLE(FUTILITY_PER_DEPTH, 100, 20, 250);
+TUNABLE(LMP_MAX_DEPTH, 6, 0, 10);          // Late move pruning: skip quiets after
+TUNABLE(LMP_BASE, 3, 0, 10);               // (BASE + depth^2) / 2 moves (not halved when improving)
+TUNABLE(PROBCUT_MIN_DEPTH, 5, 3, 10);      // ProbCut: a capture beating beta + MARGIN
+TUNABLE(PROBCUT_MARGIN, 200, 50, 400);     // at depth - 1 - REDUCTION proves the cutoff
+TUNABLE(PROBCUT_REDUCTION, 4, 2, 6);
+
+// Extension parameters (one ply each, only while ply < 2 * root depth)
+TUNABLE(SINGULAR_MIN_DEPTH, 6, 4, 12);     // Singular extension: test the TT move at depth >= 6
+TUNABLE(SINGULAR_TT_DEPTH, 3, 1, 6);       // if its lower bound is at most 3 plies shallower
+TUNABLE(SINGULAR_MARGIN, 2, 1, 6);         // Exclusion search against tt_score - MARGIN * depth
+
+// =============================================================================
+// Thread Data
+// Per-thread search state: the main thread and every Lazy SMP helper own one,
+// only the TT is shared
+// =============================================================================
 
-// Move ordering score ranges (lower = better, searched first)
-constexpr int SCORE_TT_MOVE = -1000000;    // TT move: highest priority
-constexpr int SCORE_CAPTURE_BASE = -900000; // Captures: -900000 range
-constexpr int SCORE_KILLER_1 = -700000;    // First killer move
-constexpr int SCORE_KILLER_2 = -600000;    // Second killer move
+// Root-only data, kept out of MoveList so interior nodes stay small
+struct RootMove {
+    Move move;
+    int score;      // From White's point of view (-INFINITY_SCORE for the mover if it failed low)
+    U64 nodes;      // Subtree size in the last iteration, orders the next one
+    std::vector<Move> pv;   // Principal variation from the last exact score, starting with 'move'
+};
+
+// Per-ply search state, indexed by ply + STACK_OFFSET so that the entries
+// one and two plies above the root exist (and stay empty)
+struct StackEntry {
+    Move move = 0;                              // Move being searched from this ply (0 = null move)
+    int piece = NO_PIECE;                       // Piece making it
+    PieceToHistory* continuation = nullptr;     // Its continuation history slice
+    int static_eval = EVAL_NONE;                // Side to move's static eval at this ply
+    bool improving = false;                     // Static eval above the one two plies earlier
+    Move excluded = 0;                          // TT move skipped by a singular extension search
+};
+
+constexpr int STACK_OFFSET = 2;
+
+struct ThreadData {
+    int id = 0;                             // 0 = main thread
+    Move killer_moves[MAX_PLY][2] = {};     // Two quiet moves per ply that caused beta cutoffs
+    std::vector<RootMove> root_moves;
+    int multi_pv = 1;                       // Root moves searched with an exact score
+    int root_depth = 0;                     // Depth of the current iteration (extension limit)
+    StackEntry stack[MAX_PLY + STACK_OFFSET];
+    
+    // Triangular PV table: pv[ply] holds the best line found from 'ply'
+    Move pv[MAX_PLY + 1][MAX_PLY + 1];
+    int pv_length[MAX_PLY + 1] = {};
+    
+    // Quiet move statistics (history.hpp), learned afresh for every search
+    ButterflyHistory butterfly = {};
+    CounterMoveTable counter_moves = {};
+    ContinuationHistory continuation = {};
+    
+    // Move ordering statistics: beta cutoffs, and how many came from the first move
+    U64 cutoffs = 0;
+    U64 first_move_cutoffs = 0;
+    
+    // Evaluation statistics: get_eval calls, those the eval cache answered,
+    // and static evals taken from TT entries without calling get_eval
+    U64 eval_calls = 0;
+    U64 eval_cache_hits = 0;
+    U64 tt_evals = 0;
+    
+    // Last completed iteration
+    int completed_depth = 0;
+    int score = 0;                          // Side-to-move point of view
+    Move best_move = 0;
+    
+    std::atomic<U64> nodes{0};              // Node count published for other threads
+};
 
 // =============================================================================
-// Killer Moves Table
-// Two killer moves per ply - quiet moves that caused beta cutoffs
+// Stop Signal and Search Limits
+// Raised by the UCI thread (stop), a limit, or the main thread when it is
+// done; every searcher then unwinds without storing the abandoned subtrees
 // =============================================================================
 
-inline int killer_moves[MAX_PLY][2];
+constexpr U64 POLL_INTERVAL = 2048;        // Nodes between clock checks (power of two)
+
+inline std::atomic<bool> stop_search{false};
+inline std::atomic<long long> deadline_ms{0};  // Hard limit on the steady clock, 0 = none
+inline std::atomic<U64> node_limit{0};         // Node budget over all threads, 0 = none
+inline std::atomic<U64> helper_nodes{0};       // Helper nodes, published every POLL_INTERVAL
 
-inline void clear_killers() {
-    for (int ply = 0; ply < MAX_PLY; ply++) {
-        killer_moves[ply][0] = 0;
-        killer_moves[ply][1] = 0;
+inline long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Clear the stop signal and set the limits enforced inside the search
+inline void set_limits(long long deadline, U64 nodes) {
+    deadline_ms.store(deadline);
+    node_limit.store(nodes);
+    helper_nodes.store(0);
+    stop_search.store(false);
+}
+
+// Called on entry to every node. The main thread reads the clock every
+// POLL_INTERVAL nodes so a single long iteration cannot overrun the deadline,
+// and checks the node budget at every node, so a single-threaded search
+// stops at exactly the same node every time.
+inline bool should_stop(const ThreadData& td, const Position& pos) {
+    bool poll = (pos.nodes & (POLL_INTERVAL - 1)) == 0;
+    
+    if (td.id == 0) {
+        U64 budget = node_limit.load(std::memory_order_relaxed);
+        if (budget != 0 && pos.nodes + helper_nodes.load(std::memory_order_relaxed) >= budget)
+            stop_search.store(true, std::memory_order_relaxed);
+        
+        if (poll) {
+            long long deadline = deadline_ms.load(std::memory_order_relaxed);
+            if (deadline != 0 && now_ms() >= deadline)
+                stop_search.store(true, std::memory_order_relaxed);
+        }
+    } else if (poll) {
+        helper_nodes.fetch_add(POLL_INTERVAL, std::memory_order_relaxed);
     }
+    return stop_search.load(std::memory_order_relaxed);
 }
 
-inline void store_killer(int move, int ply) {
+// =============================================================================
+// Killer Moves
+// =============================================================================
+
+inline void store_killer(ThreadData& td, Move move, int ply) {
     // Don't store captures as killers (they're already ordered by MVV-LVA)
     if (get_move_capture(move)) return;
     if (ply >= MAX_PLY) return;
     
     // Shift: move slot 0 -> slot 1, new move -> slot 0
-    if (killer_moves[ply][0] != move) {
-        killer_moves[ply][1] = killer_moves[ply][0];
-        killer_moves[ply][0] = move;
+    if (td.killer_moves[ply][0] != move) {
+        td.killer_moves[ply][1] = td.killer_moves[ply][0];
+        td.killer_moves[ply][0] = move;
     }
 }
 
-inline bool is_killer(int move, int ply) {
+inline bool is_killer(const ThreadData& td, Move move, int ply) {
     if (ply >= MAX_PLY) return false;
-    return (move == killer_moves[ply][0] || move == killer_moves[ply][1]);
+    return (move == td.killer_moves[ply][0] || move == td.killer_moves[ply][1]);
 }
 
 // =============================================================================
-// LMR Reduction Table (precomputed log-based reductions)
+// Quiet Move History
 // =============================================================================
 
-inline int lmr_table[MAX_PLY][MAX_MOVES];
-inline bool lmr_initialized = false;
+// Everything the move picker needs to order quiet moves at 'ply'
+inline QuietOrdering quiet_ordering(const ThreadData& td, int ply) {
+    const StackEntry* ss = &td.stack[ply + STACK_OFFSET];
+    QuietOrdering quiet;
+    
+    quiet.killers[0] = td.killer_moves[ply][0];
+    quiet.killers[1] = td.killer_moves[ply][1];
+    if (ss[-1].move)
+        quiet.counter_move = td.counter_moves[ss[-1].piece][get_move_target(ss[-1].move)];
+    quiet.butterfly = &td.butterfly;
+    quiet.continuation[0] = ss[-1].continuation;
+    quiet.continuation[1] = ss[-2].continuation;
+    return quiet;
+}
 
-inline void init_lmr() {
-    if (lmr_initialized) return;
+// Record the move about to be searched from 'ply' (before make_move)
+inline void push_move(ThreadData& td, const Position& pos, Move move, int ply) {
+    StackEntry& entry = td.stack[ply + STACK_OFFSET];
+    entry.move = move;
+    entry.piece = pos.board[get_move_source(move)];
+    entry.continuation = &td.continuation[entry.piece][get_move_target(move)];
+}
+
+inline void push_null_move(ThreadData& td, int ply) {
+    StackEntry& entry = td.stack[ply + STACK_OFFSET];
+    entry.move = 0;
+    entry.piece = NO_PIECE;
+    entry.continuation = nullptr;
+}
+
+// A quiet move caused a beta cutoff: reward it, penalize the quiet moves
+// searched before it in the continuation tables, and remember it as the
+// reply to the previous move. The butterfly table is context-free, so a
+// malus there would punish moves that are fine elsewhere in the tree.
+inline void update_quiet_histories(ThreadData& td, const Position& pos, int ply, int depth,
+                                   Move best_move, const Move* quiets, int quiet_count) {
+    StackEntry* ss = &td.stack[ply + STACK_OFFSET];
+    int bonus = history_bonus(depth);
     
-    for (int depth = 1; depth < MAX_PLY; depth++) {
-        for (int move_count = 1; move_count < MAX_MOVES; move_count++) {
-            // Classic LMR formula: reduction based on depth and move count
-            // R = log(depth) * log(moveCount) / 2
-            lmr_table[depth][move_count] = static_cast<int>(
-                0.75 + std::log(depth) * std::log(move_count) / 2.25
-            );
-        }
+    auto update = [&](Move move, int amount) {
+        int source = get_move_source(move);
+        int target = get_move_target(move);
+        int piece = pos.board[source];
+        if (amount > 0) update_history_entry(td.butterfly[pos.side][source][target], amount);
+        if (ss[-1].continuation) update_history_entry((*ss[-1].continuation)[piece][target], amount);
+        if (ss[-2].continuation) update_history_entry((*ss[-2].continuation)[piece][target], amount);
+    };
+    
+    update(best_move, bonus);
+    for (int i = 0; i < quiet_count; i++) {
+        if (quiets[i] != best_move) update(quiets[i], -bonus);
     }
-    lmr_initialized = true;
+    
+    if (ss[-1].move)
+        td.counter_moves[ss[-1].piece][get_move_target(ss[-1].move)] = best_move;
 }
 
 // =============================================================================
-// Helper: Get captured piece at target square
-// Returns piece type (0-11) or NO_PIECE if no capture
+// Principal Variation
 // =============================================================================
-inline int get_captured_piece(const Position& pos, int target_sq) {
-    int start = (pos.side == WHITE) ? p : P;
-    int end = (pos.side == WHITE) ? k : K;
-    
-    for (int pc = start; pc <= end; pc++) {
-        if (get_bit(pos.piece_bitboards[pc], target_sq)) {
-            return pc;
-        }
-    }
-    return NO_PIECE;
-}
 
-// Get absolute piece value (for captures/delta pruning)
-inline int get_piece_value_abs(int piece) {
-    // PIECE_VALUES has negative values for black pieces, take absolute
-    return (PIECE_VALUES[piece] < 0) ? -PIECE_VALUES[piece] : PIECE_VALUES[piece];
+// 'move' raised alpha at 'ply': the line from here is move + the child's line
+inline void update_pv(ThreadData& td, int ply, Move move) {
+    int child_length = td.pv_length[ply + 1];
+    td.pv[ply][0] = move;
+    std::copy(td.pv[ply + 1], td.pv[ply + 1] + child_length, td.pv[ply] + 1);
+    td.pv_length[ply] = child_length + 1;
 }
 
 // =============================================================================
-// Move Ordering
+// LMR Reduction Table (precomputed log-based reductions)
 // =============================================================================
 
-inline void order_moves(Position& pos, MoveList& moves, int ply = 0) {
-    for (int i = 0; i < moves.count; i++) {
-        moves.score_guess[i] = 0;
-        int move = moves.moves[i];
-        int source_piece = get_move_piece(move);
-        int target_square = get_move_target(move);
-        int promoted = get_move_promoted(move);
-        int is_check = get_move_checking(move);
-        
-        // MVV-LVA for captures (highest priority after TT move)
-        if (get_move_capture(move)) {
-            int target_piece = get_captured_piece(pos, target_square);
-            if (target_piece == NO_PIECE) target_piece = P;  // Fallback (shouldn't happen)
-            
-            // MVV-LVA: prioritize capturing high-value pieces with low-value pieces
-            // Score range: SCORE_CAPTURE_BASE ± offset (lower = better, negative scores)
-            int victim_value = get_piece_value_abs(target_piece);
-            int attacker_value = get_piece_value_abs(source_piece);
-            moves.score_guess[i] = SCORE_CAPTURE_BASE + (10 * victim_value - attacker_value);
-        }
-        // Killer moves (high priority for quiet moves)
-        else if (is_killer(move, ply)) {
-            moves.score_guess[i] = (move == killer_moves[ply][0]) ? SCORE_KILLER_1 : SCORE_KILLER_2;
-        }
-        // Quiet moves
-        else {
-            // Promotion bonus
-            if (promoted)
-                moves.score_guess[i] += -PIECE_VALUES[promoted];
-            
-            // Center control bonus
-            if (target_square == d4 || target_square == d5 || 
-                target_square == e4 || target_square == e5)
-                moves.score_guess[i] += PIECE_VALUES[source_piece];
-            
-            // Development bonus
-            if ((source_piece == B && (target_square == b2 || target_square == g2)) ||
-                (source_piece == b && (target_square == b7 || target_square == g7)) ||
-                (source_piece == N && (target_square == c3 || target_square == f3)) ||
-                (source_piece == n && (target_square == c6 || target_square == f6)))
-                moves.score_guess[i] += PIECE_VALUES[source_piece];
-            
-            // Check bonus
-            if (is_check)
-                moves.score_guess[i] += PIECE_VALUES[source_piece] / 10;
-        }
-    }
-}
+inline int lmr_table[MAX_PLY][MAX_MOVES];
 
-// Pick the best move from position 'start' to end, swap it to 'start'
-// This is O(n) per call but we often get cutoffs before searching all moves
-inline void pick_best_move(MoveList& moves, int start) {
-    int best_idx = start;
-    int best_score = moves.score_guess[start];
-    
-    for (int i = start + 1; i < moves.count; i++) {
-        if (moves.score_guess[i] < best_score) {  // Lower = better
-            best_score = moves.score_guess[i];
-            best_idx = i;
+// (Re)build the table from LMR_BASE and LMR_DIVISOR (tuning builds call it
+// again whenever either changes)
+inline void init_lmr() {
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        for (int move_count = 1; move_count < MAX_MOVES; move_count++) {
+            // Classic LMR formula: reduction based on depth and move count
+            // R = 0.75 + log(depth) * log(moveCount) / 2.25 with the default parameters
+            lmr_table[depth][move_count] = static_cast<int>(
+                LMR_BASE / 100.0 + std::log(depth) * std::log(move_count) / (LMR_DIVISOR / 100.0)
+            );
         }
     }
-    
-    if (best_idx != start) {
-        std::swap(moves.moves[start], moves.moves[best_idx]);
-        std::swap(moves.scores[start], moves.scores[best_idx]);
-        std::swap(moves.legality[start], moves.legality[best_idx]);
-        std::swap(moves.score_guess[start], moves.score_guess[best_idx]);
-    }
-}
-
-inline void sort_moves(MoveList& moves) {
-    // Selection sort - O(n²) worst case but simpler than bubble sort
-    // In practice with good move ordering + cutoffs, we rarely sort everything
-    for (int i = 0; i < moves.count - 1; i++) {
-        pick_best_move(moves, i);
-    }
 }
 
 // =============================================================================
@@ -199,76 +300,115 @@ inline void sort_moves(MoveList& moves) {
 // =============================================================================
 
 // Delta margin for futility pruning (covers promotion potential)
-constexpr int DELTA_MARGIN = 200;
+TUNABLE(DELTA_MARGIN, 200, 0, 500);
 
 // Margin for detecting mate scores (avoid NMP near checkmates)
 constexpr int MATE_SCORE_MARGIN = 100;
 
 // =============================================================================
 // Evaluation Helper (avoids duplicating NN/classic switch)
+// Consults the eval cache first, so each position is evaluated once
 // =============================================================================
-inline int get_eval(const Position& pos) {
-    return (UseNN && NN::nn_loaded) ? 
+inline int get_eval(ThreadData& td, const Position& pos) {
+    td.eval_calls++;
+    int eval;
+    if (EvalCache::probe(pos.hash, eval)) {
+        td.eval_cache_hits++;
+        return eval;
+    }
+    
+    eval = (UseNN && NN::nn_loaded) ? 
            NN::evaluate(pos.piece_bitboards, pos.side) : pos.evaluate();
+    EvalCache::store(pos.hash, eval);
+    return eval;
+}
+
+// Static eval from a TT entry when it has one, otherwise get_eval
+inline int tt_or_eval(ThreadData& td, const Position& pos, int tt_eval) {
+    if (tt_eval != EVAL_NONE) {
+        td.tt_evals++;
+        return tt_eval;
+    }
+    return get_eval(td, pos);
 }
 
-inline int quiescence(Position& pos, int alpha, int beta, int ply = 0) {
+// ply: distance from the root (mate scores, TT); qply: plies since the
+// main search handed over (the MAX_QUIESCENCE_DEPTH cap)
+inline int quiescence(ThreadData& td, Position& pos, int alpha, int beta, int ply, int qply = 0) {
+    if (should_stop(td, pos)) return 0;
+    
+    // TT probe at the depth-0 tier: any stored bound is deep enough, and the
+    // move orders the captures
+    U64 hash_key = pos.hash;
+    int tt_score;
+    Move tt_move = 0;
+    int tt_eval = EVAL_NONE;
+    if (TT::probe(hash_key, 0, ply, alpha, beta, tt_score, tt_move, tt_eval)) return tt_score;
+    
     // Check if side to move is in check
     int king_sq = Position::get_ls1b_index(pos.piece_bitboards[pos.side == WHITE ? K : k]);
     bool in_check = pos.is_square_attacked(king_sq, pos.side ^ 1);
     
     // Standing pat score
-    int stand_pat = get_eval(pos);
+    int stand_pat = tt_or_eval(td, pos, tt_eval);
     
     // Depth limit to prevent explosion
-    if (ply >= MAX_QUIESCENCE_DEPTH) return stand_pat;
+    if (qply >= MAX_QUIESCENCE_DEPTH || ply >= MAX_PLY) return stand_pat;
     
     // Standing pat is illegal when in check - must respond to check
+    int original_alpha = alpha;
     if (!in_check) {
-        if (stand_pat >= beta) return beta;
+        if (stand_pat >= beta) {
+            TT::store(hash_key, beta, 0, ply, TT::TT_BETA, 0, stand_pat);
+            return beta;
+        }
         if (stand_pat > alpha) alpha = stand_pat;
     }
     
-    MoveList moves;
-    pos.generate_moves(moves);
-    order_moves(pos, moves);
-    sort_moves(moves);
+    // When in check: search ALL evasions (not just captures)
+    // When not in check: only captures are generated
+    MovePicker picker(pos, tt_move, QuietOrdering(), !in_check);
     
     int legal_moves = 0;
+    Move best_move = 0;
+    Move move;
     
-    for (int i = 0; i < moves.count; i++) {
-        int move = moves.moves[i];
-        
-        // When in check: search ALL evasions (not just captures)
-        // When not in check: only search captures
-        if (!in_check && !get_move_capture(move)) continue;
-        
+    while ((move = picker.next_move()) != 0) {
         // =====================================================================
         // Delta Pruning: skip captures that can't raise alpha
         // If stand_pat + captured_piece + margin < alpha, this capture is futile
+        // (not when in check: every evasion counts for mate detection)
         // =====================================================================
         int target_sq = get_move_target(move);
         int captured_piece = get_captured_piece(pos, target_sq);
         
         // Skip if capture can't raise alpha (with margin for promotions)
-        if (captured_piece != NO_PIECE) {
+        if (!in_check && captured_piece != NO_PIECE) {
             int gain = get_piece_value_abs(captured_piece);
             if (stand_pat + gain + DELTA_MARGIN < alpha) continue;
         }
         
-        Position backup;
-        pos.copy_to(backup);
+        // SEE pruning: a capture that loses material cannot beat standing pat
+        if (!in_check && !pos.see_ge(move, 0)) continue;
         
-        if (!pos.make_move(move, ALL_MOVES)) continue;
+        pos.make_move(move, ALL_MOVES);  // Generator is fully legal
         
         legal_moves++;
         pos.nodes++;  // Count nodes consistently with negamax (after legal move)
         
-        int score = -quiescence(pos, -beta, -alpha, ply + 1);
-        backup.copy_to(pos);
+        int score = -quiescence(td, pos, -beta, -alpha, ply + 1, qply + 1);
+        pos.unmake_move();
+        
+        if (stop_search.load(std::memory_order_relaxed)) return 0;
         
-        if (score >= beta) return beta;
-        if (score > alpha) alpha = score;
+        if (score >= beta) {
+            TT::store(hash_key, beta, 0, ply, TT::TT_BETA, move, stand_pat);
+            return beta;
+        }
+        if (score > alpha) {
+            alpha = score;
+            best_move = move;
+        }
     }
     
     // If in check and no legal moves, it's checkmate
@@ -276,6 +416,8 @@ inline int quiescence(Position& pos, int alpha, int beta, int ply = 0) {
         return -CHECKMATE_SCORE + ply;
     }
     
+    TT::TTFlag flag = (alpha > original_alpha) ? TT::TT_EXACT : TT::TT_ALPHA;
+    TT::store(hash_key, alpha, 0, ply, flag, best_move, stand_pat);
     return alpha;
 }
 
@@ -283,83 +425,206 @@ inline int quiescence(Position& pos, int alpha, int beta, int ply = 0) {
 // Alpha-Beta Search with TT
 // =============================================================================
 
-inline int negamax(Position& pos, int depth, int alpha, int beta, int ply = 0, bool do_null = true) {
-    // Generate hash key for TT
-    U64 hash_key = TT::generate_hash_key(pos);
-    int tt_score, tt_move = 0;
+inline int negamax(ThreadData& td, Position& pos, int depth, int alpha, int beta, int ply = 0, bool do_null = true) {
+    // Nodes that return early (TT cutoff, qsearch, draw) contribute no moves to the PV
+    td.pv_length[ply] = 0;
+    
+    // Abandoned search: the caller discards the result
+    if (should_stop(td, pos)) return 0;
+    
+    // Repetition or fifty-move draw (not at the root, which must return a move)
+    if (ply > 0 && pos.is_draw(ply)) return DRAW_SCORE;
+    
+    // Per-ply tables end here
+    if (ply >= MAX_PLY) return get_eval(td, pos);
+    
+    // Mate distance pruning: no line from here beats mating at this ply or
+    // escapes being mated at the next one, so a mate already found closer
+    // to the root bounds the window
+    if (ply > 0) {
+        alpha = std::max(alpha, -CHECKMATE_SCORE + ply);
+        beta = std::min(beta, CHECKMATE_SCORE - ply - 1);
+        if (alpha >= beta) return alpha;
+    }
+    
+    // Singular extension search of this node: same position without the TT move
+    StackEntry* ss = &td.stack[ply + STACK_OFFSET];
+    Move excluded = ss->excluded;
+    
+    // Hash key for TT (maintained incrementally by make_move)
+    U64 hash_key = pos.hash;
+    int tt_score;
+    Move tt_move = 0;
+    int tt_eval = EVAL_NONE;
     
-    // TT probe: check if we've seen this position before
-    if (TT::probe(hash_key, depth, ply, alpha, beta, tt_score, tt_move)) {
+    // TT probe: check if we've seen this position before (the entry belongs
+    // to the full node, so an exclusion search only takes its move and eval)
+    if (TT::probe(hash_key, depth, ply, alpha, beta, tt_score, tt_move, tt_eval) && !excluded) {
         return tt_score;
     }
     
     if (depth == 0) {
-        return quiescence(pos, alpha, beta);
+        return quiescence(td, pos, alpha, beta, ply);
     }
     
     // Check detection (needed for NMP safety and checkmate detection)
     int king_sq = Position::get_ls1b_index(pos.piece_bitboards[pos.side == WHITE ? K : k]);
     bool in_check = pos.is_square_attacked(king_sq, pos.side ^ 1);
+    bool pv_node = beta - alpha > 1;
+    
+    // Static eval on the search stack: "improving" compares it with our
+    // eval two plies earlier (no eval when in check)
+    int static_eval = in_check ? EVAL_NONE : tt_or_eval(td, pos, tt_eval);
+    bool improving = !in_check && ss[-2].static_eval != EVAL_NONE && static_eval > ss[-2].static_eval;
+    ss->static_eval = static_eval;
+    ss->improving = improving;
+    
+    // Forward pruning only where a wrong guess cannot change the PV or hide a mate
+    bool can_prune = !pv_node && !in_check && !excluded && std::abs(beta) < CHECKMATE_SCORE - MATE_SCORE_MARGIN;
+    
+    // =========================================================================
+    // Reverse Futility Pruning (RFP)
+    // Static eval beats beta by a depth-scaled margin: assume the cutoff
+    // =========================================================================
+    if (can_prune && depth <= RFP_MAX_DEPTH &&
+        static_eval - RFP_MARGIN * (depth - improving) >= beta) {
+        return beta;
+    }
+    
+    // =========================================================================
+    // Razoring
+    // Static eval far below alpha: drop into qsearch, trust it if it agrees
+    // =========================================================================
+    if (can_prune && depth <= RAZOR_MAX_DEPTH && static_eval + RAZOR_MARGIN * depth < alpha) {
+        int score = quiescence(td, pos, alpha, alpha + 1, ply);
+        if (score <= alpha) return alpha;
+    }
     
     // =========================================================================
     // Null Move Pruning (NMP)
     // Safety gates: not in check, eval >= beta, non-pawn material, no mate scores
     // =========================================================================
     if (do_null && !in_check && depth >= NMP_MIN_DEPTH && std::abs(beta) < CHECKMATE_SCORE - MATE_SCORE_MARGIN) {
-        // Get static eval for the safety gate
-        int eval = get_eval(pos);
-        
         // Only try NMP if position looks good (eval >= beta)
-        if (eval >= beta) {
+        if (static_eval >= beta) {
             // Need non-pawn material to avoid zugzwang
             U64 pieces = (pos.side == WHITE) 
                 ? (pos.piece_bitboards[N] | pos.piece_bitboards[B] | pos.piece_bitboards[R] | pos.piece_bitboards[Q])
                 : (pos.piece_bitboards[n] | pos.piece_bitboards[b] | pos.piece_bitboards[r] | pos.piece_bitboards[q]);
             
             if (pieces) {
-                Position backup;
-                pos.copy_to(backup);
-                pos.side ^= 1;
-                pos.enpassant = NO_SQUARE;
+                push_null_move(td, ply);
+                pos.make_null_move();
                 
                 // R=3 reduction (depth - 1 - R), depth floor at 1
-                int score = -negamax(pos, std::max(1, depth - 1 - NMP_REDUCTION), -beta, -beta + 1, ply + 1, false);
-                backup.copy_to(pos);
+                int score = -negamax(td, pos, std::max(1, depth - 1 - NMP_REDUCTION), -beta, -beta + 1, ply + 1, false);
+                pos.unmake_null_move();
                 
                 if (score >= beta) return beta;
             }
         }
     }
     
-    int original_alpha = alpha;
-    MoveList moves;
-    pos.generate_moves(moves);
-    order_moves(pos, moves, ply);
-    
-    // TT move ordering: if we have a TT move, boost its priority
-    if (tt_move != 0) {
-        for (int i = 0; i < moves.count; i++) {
-            if (moves.moves[i] == tt_move) {
-                moves.score_guess[i] = SCORE_TT_MOVE;  // Highest priority
-                break;
+    // =========================================================================
+    // ProbCut
+    // A capture that beats beta by a margin in a much shallower search will
+    // almost surely beat beta at full depth. Captures whose exchange can
+    // cover the gap are screened with qsearch, then verified at reduced depth
+    // =========================================================================
+    int probcut_beta = beta + PROBCUT_MARGIN;
+    if (can_prune && depth >= PROBCUT_MIN_DEPTH && probcut_beta < CHECKMATE_SCORE - MATE_SCORE_MARGIN) {
+        MovePicker probcut_picker(pos, tt_move, QuietOrdering(), true);
+        Move capture;
+        
+        while ((capture = probcut_picker.next_move()) != 0) {
+            if (!pos.see_ge(capture, probcut_beta - static_eval)) continue;
+            
+            push_move(td, pos, capture, ply);
+            pos.make_move(capture, ALL_MOVES);  // Generator is fully legal
+            pos.nodes++;
+            
+            int score = -quiescence(td, pos, -probcut_beta, -probcut_beta + 1, ply + 1);
+            if (score >= probcut_beta)
+                score = -negamax(td, pos, depth - 1 - PROBCUT_REDUCTION, -probcut_beta, -probcut_beta + 1, ply + 1);
+            pos.unmake_move();
+            
+            if (stop_search.load(std::memory_order_relaxed)) return 0;
+            
+            if (score >= probcut_beta) {
+                TT::store(hash_key, probcut_beta, depth - PROBCUT_REDUCTION, ply, TT::TT_BETA, capture, static_eval);
+                return beta;
+            }
+        }
+    }
+    
+    // =========================================================================
+    // Singular Extension
+    // The TT move holds a lower bound from a search nearly as deep as this
+    // one. Search the node without it at half depth against a bound below
+    // its score: if every alternative fails low, the TT move is the only
+    // good move here and gets one ply more
+    // =========================================================================
+    bool singular = false;
+    if (ply > 0 && !excluded && tt_move && depth >= SINGULAR_MIN_DEPTH && ply < 2 * td.root_depth) {
+        U64 tt_data;
+        if (TT::read_entry(hash_key, tt_data) && TT::data_move(tt_data) == tt_move &&
+            TT::data_flag(tt_data) != TT::TT_ALPHA && TT::data_depth(tt_data) >= depth - SINGULAR_TT_DEPTH) {
+            int tt_value = TT::score_from_tt(TT::data_score(tt_data), ply);
+            
+            if (std::abs(tt_value) < CHECKMATE_SCORE - MATE_SCORE_MARGIN) {
+                int singular_beta = tt_value - SINGULAR_MARGIN * depth;
+                
+                ss->excluded = tt_move;
+                int score = negamax(td, pos, (depth - 1) / 2, singular_beta - 1, singular_beta, ply, false);
+                ss->excluded = 0;
+                
+                if (stop_search.load(std::memory_order_relaxed)) return 0;
+                singular = score < singular_beta;
             }
         }
     }
     
-    sort_moves(moves);
+    int original_alpha = alpha;
+    // Staged ordering: TT move, captures, killers, countermove, quiets (generated lazily)
+    QuietOrdering quiet = quiet_ordering(td, ply);
+    MovePicker picker(pos, tt_move, quiet, false);
     
     int legal_moves = 0;
-    int best_move = 0;
+    Move best_move = 0;
     int best_score = -INFINITY_SCORE;
+    Move quiets_tried[MAX_MOVES];
+    int quiet_count = 0;
+    Move move;
     
-    for (int i = 0; i < moves.count; i++) {
-        int move = moves.moves[i];
-        Position backup;
-        pos.copy_to(backup);
+    // Quiet move pruning at frontier nodes (never the first move: mate detection needs one)
+    bool futile = can_prune && depth <= FUTILITY_MAX_DEPTH &&
+                  static_eval + FUTILITY_BASE + FUTILITY_PER_DEPTH * depth <= alpha;
+    int lmp_limit = (can_prune && depth <= LMP_MAX_DEPTH)
+                  ? (LMP_BASE + depth * depth) / (improving ? 1 : 2) : MAX_MOVES;
+    
+    while ((move = picker.next_move()) != 0) {
+        if (move == excluded) continue;
+        
+        bool is_quiet = !get_move_capture(move) && !get_move_promotion(move);
+        bool gives_check = pos.gives_check(move);
         
-        if (!pos.make_move(move, ALL_MOVES))
+        // Quiet moves that give check are never pruned: they are how mates are found
+        // - Futility: the move cannot lift the eval to alpha
+        // - Late move pruning: enough quiet moves were tried at this depth
+        if (is_quiet && legal_moves > 0 && (futile || legal_moves >= lmp_limit) && !gives_check)
             continue;
         
+        // Extensions: checks, and a singular TT move (bounded by the line length)
+        int extension = 0;
+        if (ply < 2 * td.root_depth && (gives_check || (singular && move == tt_move)))
+            extension = 1;
+        int new_depth = depth - 1 + extension;
+        
+        int history = is_quiet ? quiet.score(pos.board, pos.side, move) : 0;
+        
+        push_move(td, pos, move, ply);
+        pos.make_move(move, ALL_MOVES);  // Generator is fully legal
+        
         legal_moves++;
         pos.nodes++;
         
@@ -370,7 +635,6 @@ inline int negamax(Position& pos, int depth, int alpha, int beta, int ply = 0, b
         // Reduce search depth for late quiet moves that are unlikely to be good
         // Safety gates: not in check, depth >= 3, move >= 4, not a capture/promotion
         // =====================================================================
-        bool is_quiet = !get_move_capture(move) && !get_move_promoted(move);
         bool can_reduce = !in_check && depth >= LMR_MIN_DEPTH && legal_moves >= LMR_MIN_MOVE_COUNT && is_quiet;
         
         if (can_reduce) {
@@ -378,24 +642,30 @@ inline int negamax(Position& pos, int depth, int alpha, int beta, int ply = 0, b
             int reduction = lmr_table[std::min(depth, MAX_PLY - 1)][std::min(legal_moves, MAX_MOVES - 1)];
             
             // Reduce killer moves less (they proved good at this ply)
-            if (is_killer(move, ply)) reduction = std::max(0, reduction - 1);
+            if (is_killer(td, move, ply)) reduction = std::max(0, reduction - 1);
+            
+            // Moves with good history are reduced less, bad ones more
+            reduction = std::max(0, reduction - history / LMR_HISTORY_DIVISOR);
             
             // Ensure we don't reduce below depth 1
-            int reduced_depth = std::max(1, depth - 1 - reduction);
+            int reduced_depth = std::max(1, new_depth - reduction);
             
             // Reduced-depth search with null window
-            score = -negamax(pos, reduced_depth, -alpha - 1, -alpha, ply + 1);
+            score = -negamax(td, pos, reduced_depth, -alpha - 1, -alpha, ply + 1);
             
             // If reduced search fails high, re-search at full depth
             if (score > alpha) {
-                score = -negamax(pos, depth - 1, -beta, -alpha, ply + 1);
+                score = -negamax(td, pos, new_depth, -beta, -alpha, ply + 1);
             }
         } else {
             // Full-depth search for early moves, captures, promotions, and when in check
-            score = -negamax(pos, depth - 1, -beta, -alpha, ply + 1);
+            score = -negamax(td, pos, new_depth, -beta, -alpha, ply + 1);
         }
         
-        backup.copy_to(pos);
+        pos.unmake_move();
+        
+        // Scores from an abandoned subtree are meaningless: store nothing
+        if (stop_search.load(std::memory_order_relaxed)) return 0;
         
         if (score > best_score) {
             best_score = score;
@@ -403,76 +673,281 @@ inline int negamax(Position& pos, int depth, int alpha, int beta, int ply = 0, b
         }
         
         if (score >= beta) {
-            // Store killer move for quiet moves that cause beta cutoffs
-            store_killer(move, ply);
+            td.cutoffs++;
+            if (legal_moves == 1) td.first_move_cutoffs++;
+            
+            // Quiet cutoff: killer, countermove and history updates
+            if (is_quiet) {
+                store_killer(td, move, ply);
+                update_quiet_histories(td, pos, ply, depth, move, quiets_tried, quiet_count);
+            }
             
             // Store with BETA flag (lower bound - failed high)
-            TT::store(hash_key, beta, depth, ply, TT::TT_BETA, best_move);
+            if (!excluded) TT::store(hash_key, beta, depth, ply, TT::TT_BETA, best_move, static_eval);
             return beta;
         }
         
-        if (score > alpha)
+        if (score > alpha) {
             alpha = score;
+            update_pv(td, ply, move);
+        }
+        if (is_quiet) quiets_tried[quiet_count++] = move;
     }
     
-    // Checkmate or stalemate detection (reuse in_check from above)
+    // Checkmate or stalemate detection (reuse in_check from above); an
+    // exclusion search without alternatives just fails low
     if (legal_moves == 0) {
+        if (excluded) return alpha;
         if (in_check)
             return -CHECKMATE_SCORE + ply;  // Checkmate: prefer faster mates
         return STALEMATE_SCORE;  // Stalemate
     }
     
-    // Store result in TT
+    // Store result in TT (not for an exclusion search, whose bound omits the best move)
     TT::TTFlag flag = (alpha > original_alpha) ? TT::TT_EXACT : TT::TT_ALPHA;
-    TT::store(hash_key, alpha, depth, ply, flag, best_move);
+    if (!excluded) TT::store(hash_key, alpha, depth, ply, flag, best_move, static_eval);
     
     return alpha;
 }
 
-inline MoveList search(Position& pos, int depth) {
-    MoveList moves;
-    pos.generate_moves(moves);
-    order_moves(pos, moves, 0);  // Root level = ply 0
-    sort_moves(moves);
+// =============================================================================
+// Root Search
+// =============================================================================
+
+// Aspiration window parameters
+TUNABLE(ASPIRATION_MIN_DEPTH, 4, 1, 8);    // Full window for shallow iterations
+TUNABLE(ASPIRATION_WINDOW, 25, 5, 100);    // Initial half-width around the previous score
+
+// Root moves in picker order (root level = ply 0)
+inline std::vector<RootMove> generate_root_moves(const ThreadData& td, Position& pos) {
+    std::vector<RootMove> root_moves;
+    MovePicker picker(pos, 0, quiet_ordering(td, 0), false);
+    Move move;
+    while ((move = picker.next_move()) != 0)
+        root_moves.push_back({move, 0, 0, {}});
+    return root_moves;
+}
+
+// One root iteration inside (alpha, beta), side-to-move point of view.
+// The first td.multi_pv moves get the full window. Every later move is
+// tried with a null window against the multi_pv-th best score so far (alpha
+// while fewer moves have beaten it) and re-searched with the full window
+// only when it beats that score; with a single PV this is plain PVS with
+// alpha carried across root moves.
+// On return the multi_pv best moves lead, by score, and the rest are ordered
+// by subtree size; a stopped iteration only promotes a move that completed
+// with a better score.
+inline int search_root(ThreadData& td, Position& pos, int depth, int alpha, int beta) {
+    std::vector<RootMove>& root_moves = td.root_moves;
+    size_t multi_pv = std::min<size_t>(td.multi_pv, root_moves.size());
+    std::vector<int> scores(root_moves.size(), -INFINITY_SCORE);  // This iteration's results
+    std::vector<int> top_scores;                                 // Best exact scores, descending
+    int best_score = -INFINITY_SCORE;
+    size_t best_index = 0;
     
-    for (int i = 0; i < moves.count; i++) {
-        Position backup;
-        pos.copy_to(backup);
+    for (size_t i = 0; i < root_moves.size(); i++) {
+        RootMove& root_move = root_moves[i];
+        U64 nodes_before = pos.nodes;
         
-        if (!pos.make_move(moves.moves[i], ALL_MOVES)) {
-            moves.legality[i] = false;
-            continue;
+        // Score a move must beat to enter the top multi_pv
+        int bound = (top_scores.size() == multi_pv) ? top_scores.back() : alpha;
+        
+        push_move(td, pos, root_move.move, 0);
+        pos.make_move(root_move.move, ALL_MOVES);  // Generator is fully legal
+        pos.nodes++;
+        
+        int score;
+        if (i < multi_pv) {
+            score = -negamax(td, pos, depth - 1, -beta, -bound, 1);
+        } else {
+            // PVS: prove the move is no better than the bound with a null window
+            score = -negamax(td, pos, depth - 1, -bound - 1, -bound, 1);
+            if (score > bound && score < beta)
+                score = -negamax(td, pos, depth - 1, -beta, -bound, 1);
+        }
+        
+        pos.unmake_move();
+        root_move.nodes = pos.nodes - nodes_before;
+        td.nodes.store(pos.nodes, std::memory_order_relaxed);
+        
+        if (stop_search.load(std::memory_order_relaxed)) {
+            std::swap(root_moves[0], root_moves[best_index]);
+            return best_score;
         }
         
-        moves.legality[i] = true;
-        int score = -negamax(pos, depth - 1, -INFINITY_SCORE, INFINITY_SCORE);
+        // Only moves that beat the bound have a usable score and PV
+        int mover_score = (score > bound) ? score : -INFINITY_SCORE;
+        root_move.score = (pos.side == WHITE) ? mover_score : -mover_score;
+        scores[i] = score;
         
-        backup.copy_to(pos);
+        if (score > bound) {
+            root_move.pv.assign(1, root_move.move);
+            root_move.pv.insert(root_move.pv.end(), td.pv[1], td.pv[1] + td.pv_length[1]);
+            
+            top_scores.insert(std::upper_bound(top_scores.begin(), top_scores.end(), score,
+                                               std::greater<int>()), score);
+            if (top_scores.size() > multi_pv) top_scores.pop_back();
+        }
         
-        moves.scores[i] = (pos.side == WHITE) ? score : -score;
+        if (score > best_score) {
+            best_score = score;
+            best_index = i;
+        }
+        if (score >= beta) break;  // Fail high: the caller widens the window
     }
     
-    return moves;
+    if (root_moves.empty()) return best_score;
+    
+    // Best (or failing-high) moves first, then the most expensive subtrees
+    std::vector<size_t> order(root_moves.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+    std::stable_sort(order.begin() + multi_pv, order.end(),
+                     [&](size_t a, size_t b) { return root_moves[a].nodes > root_moves[b].nodes; });
+    
+    std::vector<RootMove> sorted;
+    sorted.reserve(root_moves.size());
+    for (size_t index : order)
+        sorted.push_back(std::move(root_moves[index]));
+    root_moves = std::move(sorted);
+    
+    return best_score;
 }
 
-inline int find_best_move(Position& pos, MoveList& moves) {
-    int best_move = 0;
-    int best_score = (pos.side == WHITE) ? -INFINITY_SCORE : INFINITY_SCORE;
+// Search one iteration in a window around the previous score (side-to-move
+// point of view), widening the failing side until the score lies inside.
+// MultiPV uses the full window: the lower lines would fall below a narrow one.
+inline int aspiration_search(ThreadData& td, Position& pos, int depth, int prev_score) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INFINITY_SCORE;
+    int beta = INFINITY_SCORE;
+    
+    if (td.multi_pv == 1 && depth >= ASPIRATION_MIN_DEPTH && std::abs(prev_score) < CHECKMATE_SCORE - MATE_SCORE_MARGIN) {
+        alpha = prev_score - delta;
+        beta = prev_score + delta;
+    }
     
-    for (int i = 0; i < moves.count; i++) {
-        if (!moves.legality[i]) continue;
+    while (true) {
+        int score = search_root(td, pos, depth, alpha, beta);
+        if (stop_search.load(std::memory_order_relaxed)) return score;
         
-        bool is_better = (pos.side == WHITE) ? 
-            (moves.scores[i] > best_score) :
-            (moves.scores[i] < best_score);
+        if (score <= alpha && alpha > -INFINITY_SCORE) {
+            beta = (alpha + beta) / 2;
+            alpha = std::max(score - delta, -INFINITY_SCORE);
+        } else if (score >= beta && beta < INFINITY_SCORE) {
+            beta = std::min(score + delta, INFINITY_SCORE);
+        } else {
+            return score;
+        }
         
-        if (is_better) {
-            best_score = moves.scores[i];
-            best_move = moves.moves[i];
+        // Fall back to a full window once the widening gets large
+        delta += delta / 2;
+        if (delta > CHECKMATE_SCORE / 4) {
+            alpha = -INFINITY_SCORE;
+            beta = INFINITY_SCORE;
         }
     }
+}
+
+// One iteration of iterative deepening, recorded in 'td' unless it was
+// stopped; a stopped iteration still updates the best move from the
+// partial root results
+inline bool search_iteration(ThreadData& td, Position& pos, int depth) {
+    td.root_depth = depth;
+    int score = aspiration_search(td, pos, depth, td.score);
+    if (td.root_moves.empty()) return false;
+    
+    if (stop_search.load(std::memory_order_relaxed)) {
+        td.best_move = td.root_moves[0].move;
+        return false;
+    }
+    
+    td.completed_depth = depth;
+    td.score = score;
+    td.best_move = td.root_moves[0].move;
+    return true;
+}
+
+// =============================================================================
+// Lazy SMP
+// =============================================================================
+//
+// Helper threads run their own iterative deepening on copies of the root
+// position while the caller runs the main thread's loop. They communicate
+// only through the shared TT: their entries give the main thread better
+// moves and cutoffs. Each helper skips depths in a staggered pattern so the
+// threads do not all search the same iteration at the same time.
+//
+// =============================================================================
+
+// Depth skipping pattern by helper: a depth is skipped when
+// ((depth + phase) / size) is odd; the pattern repeats after 20 helpers
+constexpr int SKIP_SIZE[20]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr int SKIP_PHASE[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+inline void helper_loop(ThreadData& td, Position& pos, int max_depth) {
+    td.root_moves = generate_root_moves(td, pos);
+    int pattern = (td.id - 1) % 20;
     
-    return best_move;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        if (stop_search.load(std::memory_order_relaxed)) break;
+        if (((depth + SKIP_PHASE[pattern]) / SKIP_SIZE[pattern]) % 2) continue;
+        search_iteration(td, pos, depth);
+    }
+    td.nodes.store(pos.nodes, std::memory_order_relaxed);
 }
 
+class SearchThreads {
+public:
+    ~SearchThreads() { stop(); }
+    
+    // Start 'count' helpers searching copies of 'root' up to 'max_depth'
+    // (the caller clears stop_search before the search starts)
+    void start(const Position& root, int count, int max_depth) {
+        for (int i = 1; i <= count; i++) {
+            data.emplace_back(new ThreadData());
+            data.back()->id = i;
+            
+            // Heap-allocated: Position carries a full undo stack
+            positions.emplace_back(new Position());
+            root.copy_to(*positions.back());
+        }
+        for (int i = 0; i < count; i++)
+            threads.emplace_back(helper_loop, std::ref(*data[i]), std::ref(*positions[i]), max_depth);
+    }
+    
+    // Signal the helpers and wait for them to finish
+    void stop() {
+        stop_search.store(true);
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+    }
+    
+    // Nodes searched by all helpers (approximate while they are running)
+    U64 nodes() const {
+        U64 total = 0;
+        for (const auto& td : data)
+            total += td->nodes.load(std::memory_order_relaxed);
+        return total;
+    }
+    
+    // The main thread's result, unless a helper completed a deeper
+    // iteration with a better score
+    const ThreadData& best(const ThreadData& main) const {
+        const ThreadData* best = &main;
+        for (const auto& td : data) {
+            if (td->completed_depth > best->completed_depth && td->score > best->score)
+                best = td.get();
+        }
+        return *best;
+    }
+    
+private:
+    std::vector<std::unique_ptr<ThreadData>> data;
+    std::vector<std::unique_ptr<Position>> positions;
+    std::vector<std::thread> threads;
+};
+
 } // namespace Search
@@ -0,0 +1,225 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - SPSA Tuning
+// =============================================================================
+//
+// Simultaneous perturbation stochastic approximation over every registered
+// search parameter (tune.hpp), driven by local self-play:
+//   1. Every parameter is shifted by +-c_k in a random direction, giving two
+//      engines, theta+ and theta-
+//   2. They play a game pair from a random opening (both colours), one
+//      node-limited search per move
+//   3. Each parameter moves along its direction by R_k * c_k * result, where
+//      result is theta+'s score minus theta-'s over the pair
+//
+// Step sizes follow the usual schedule: c_k = c / k^0.101 and
+// a_k = a / (A + k)^0.602 with A = N / 10, R_k = a_k / c_k^2. Each
+// parameter ends at c_end = range / 20 (at least 1) and an end learning
+// rate of R_END.
+//
+// Games are adjudicated by the engines' own scores (a side both engines
+// agree is lost for ADJUDICATE_PLIES plies), checkmate, stalemate,
+// repetition and the fifty-move rule, or drawn at MAX_GAME_LENGTH plies.
+// The TT is cleared before every move so neither side inherits the
+// other's entries.
+//
+// Only a tuning build (BATU_TUNE) registers parameters.
+//
+// =============================================================================
+
+#include "position.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "tune.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace Spsa {
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+constexpr double ALPHA = 0.602;            // a_k decay
+constexpr double GAMMA = 0.101;            // c_k decay
+constexpr double R_END = 0.002;            // Learning rate at the last iteration
+constexpr int OPENING_PLIES = 6;           // Random plies from the start position
+constexpr int MAX_GAME_LENGTH = 200;       // Plies before a game is drawn
+constexpr int ADJUDICATE_SCORE = 1000;     // Centipawns
+constexpr int ADJUDICATE_PLIES = 4;
+
+// xorshift64: openings and perturbation directions
+struct Rng {
+    U64 state;
+    U64 next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+};
+
+// =============================================================================
+// Self-Play
+// =============================================================================
+
+inline void apply(const std::vector<int>& values) {
+    std::vector<Tune::Param>& params = Tune::params();
+    for (size_t i = 0; i < params.size(); i++)
+        Tune::set(params[i], values[i]);
+}
+
+// One node-limited search for the side to move; 'score' from its point of view
+inline Move search_move(Position& pos, U64 nodes, int& score) {
+    TT::clear();
+    pos.nodes = 0;
+    Search::set_limits(0, nodes);
+
+    std::unique_ptr<Search::ThreadData> td(new Search::ThreadData());
+    td->root_moves = Search::generate_root_moves(*td, pos);
+    if (td->root_moves.empty()) return 0;
+
+    for (int depth = 1; depth < Search::MAX_PLY; depth++) {
+        if (!Search::search_iteration(*td, pos, depth)) break;
+    }
+    score = td->score;
+    return td->best_move;
+}
+
+// Random legal opening from the start position, stored in 'moves'
+inline void random_opening(Rng& rng, std::vector<Move>& moves) {
+    std::unique_ptr<Position> pos(new Position());
+
+    while (true) {
+        moves.clear();
+        pos->parse_fen(START_POSITION);
+        for (int ply = 0; ply < OPENING_PLIES; ply++) {
+            MoveList list;
+            pos->generate_moves(list);
+            if (list.count == 0) break;
+            Move move = list.moves[rng.next() % list.count].move;
+            pos->make_move(move, ALL_MOVES);
+            moves.push_back(move);
+        }
+
+        MoveList replies;
+        pos->generate_moves(replies);
+        if (static_cast<int>(moves.size()) == OPENING_PLIES && replies.count > 0) return;
+    }
+}
+
+// Play one game; +1 White wins, -1 Black wins, 0 draw
+inline int play_game(const std::vector<Move>& opening, const std::vector<int>& white,
+                     const std::vector<int>& black, U64 nodes) {
+    std::unique_ptr<Position> pos(new Position());
+    pos->parse_fen(START_POSITION);
+    for (Move move : opening)
+        pos->make_move(move, ALL_MOVES);
+
+    int streak = 0;     // Consecutive plies with a decisive score, signed for White
+
+    for (int ply = 0; ply < MAX_GAME_LENGTH; ply++) {
+        apply(pos->side == WHITE ? white : black);
+
+        int score = 0;
+        Move move = search_move(*pos, nodes, score);
+
+        // No legal move: checkmate or stalemate
+        if (!move) {
+            int king_sq = Position::get_ls1b_index(pos->piece_bitboards[pos->side == WHITE ? K : k]);
+            if (!pos->is_square_attacked(king_sq, pos->side ^ 1)) return 0;
+            return (pos->side == WHITE) ? -1 : 1;
+        }
+
+        // Both engines must agree on a decisive score for several plies
+        int white_score = (pos->side == WHITE) ? score : -score;
+        if (std::abs(white_score) >= ADJUDICATE_SCORE && (streak == 0 || (streak > 0) == (white_score > 0)))
+            streak += (white_score > 0) ? 1 : -1;
+        else
+            streak = 0;
+        if (std::abs(streak) >= ADJUDICATE_PLIES) return (streak > 0) ? 1 : -1;
+
+        pos->make_move(move, ALL_MOVES);
+
+        // Threefold repetition or fifty-move rule
+        if (pos->is_draw(0)) return 0;
+    }
+    return 0;
+}
+
+// =============================================================================
+// Tuning Loop
+// =============================================================================
+
+inline void run(int iterations, U64 nodes) {
+    std::vector<Tune::Param>& params = Tune::params();
+    if (params.empty()) {
+        std::cout << "info string spsa: no tunable parameters (build with BATU_TUNE)" << std::endl;
+        return;
+    }
+
+    size_t count = params.size();
+    double big_a = iterations / 10.0;
+    std::vector<double> theta(count), c(count), a(count);
+    for (size_t i = 0; i < count; i++) {
+        theta[i] = *params[i].value;
+        double c_end = std::max(1.0, (params[i].max - params[i].min) / 20.0);
+        c[i] = c_end * std::pow(iterations, GAMMA);
+        a[i] = R_END * c_end * c_end * std::pow(big_a + iterations, ALPHA);
+    }
+
+    std::cout << "info string spsa: " << count << " parameters, " << iterations
+              << " iterations, " << nodes << " nodes per move" << std::endl;
+
+    Rng rng{0x9E3779B97F4A7C15ULL};
+    std::vector<int> plus(count), minus(count);
+    std::vector<double> delta(count);
+    std::vector<Move> opening;
+    int total_result = 0;
+
+    for (int k = 1; k <= iterations; k++) {
+        for (size_t i = 0; i < count; i++) {
+            double c_k = c[i] / std::pow(k, GAMMA);
+            delta[i] = (rng.next() & 1) ? 1.0 : -1.0;
+            plus[i] = std::clamp(static_cast<int>(std::lround(theta[i] + c_k * delta[i])), params[i].min, params[i].max);
+            minus[i] = std::clamp(static_cast<int>(std::lround(theta[i] - c_k * delta[i])), params[i].min, params[i].max);
+        }
+
+        // Game pair: theta+ takes each colour once
+        random_opening(rng, opening);
+        int result = play_game(opening, plus, minus, nodes) - play_game(opening, minus, plus, nodes);
+        total_result += result;
+
+        for (size_t i = 0; i < count; i++) {
+            double c_k = c[i] / std::pow(k, GAMMA);
+            double a_k = a[i] / std::pow(big_a + k, ALPHA);
+            double r_k = a_k / (c_k * c_k);
+            theta[i] = std::clamp(theta[i] + r_k * c_k * result * delta[i],
+                                  static_cast<double>(params[i].min), static_cast<double>(params[i].max));
+        }
+
+        std::printf("info string spsa iteration %d/%d result %+d (sum %+d)\n", k, iterations, result, total_result);
+        if (k % 10 == 0 || k == iterations) {
+            std::printf("info string spsa values");
+            for (size_t i = 0; i < count; i++)
+                std::printf(" %s=%.2f", params[i].name, theta[i]);
+            std::printf("\n");
+        }
+        std::fflush(stdout);
+    }
+
+    // Keep the tuned values, printed as commands for a later session
+    for (size_t i = 0; i < count; i++) {
+        Tune::set(params[i], static_cast<int>(std::lround(theta[i])));
+        std::printf("info string setoption name %s value %d\n", params[i].name, *params[i].value);
+    }
+    TT::clear();
+}
+
+} // namespace Spsa
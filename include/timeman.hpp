@@ -0,0 +1,315 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Time Management
+// =============================================================================
+//
+// Two limits per move:
+// - Hard: never exceeded. The search polls it as Search::deadline_ms, so an
+//   iteration that runs long is cut off mid-search.
+// - Soft: checked after every completed iteration, scaled by how settled
+//   the search looks:
+//   - effort: share of the root nodes spent under the best move (a move
+//     that took most of the tree is unlikely to be overturned)
+//   - instability: best-move changes, halved every iteration
+//   - falling eval: score drop since the previous iteration
+//
+// The manager only does arithmetic on clock values and iteration
+// statistics, so the offline simulator (timesim) replays recorded
+// iterations through exactly the same code.
+//
+// =============================================================================
+
+#include "types.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace TimeMan {
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+constexpr int MOVE_OVERHEAD = 50;          // Safety margin per move (ms)
+constexpr int MIN_THINK_TIME = 10;         // Never plan less than this (ms)
+
+// Sudden death: assumed moves left, by remaining time
+constexpr int MTG_PLENTY = 40;             // More than 60s left
+constexpr int MTG_NORMAL = 30;
+constexpr int MTG_LOW = 20;                // Less than 10s left
+constexpr int MTG_PANIC = 15;              // Less than 5s left
+
+constexpr int HARD_RATIO_MTG = 3;          // Hard = soft * 3 with movestogo
+constexpr double HARD_RATIO_SUDDEN = 2.5;  // Hard = soft * 2.5 in sudden death
+constexpr int MAX_TIME_FRACTION = 5;       // Sudden death: at most 1/5 of the clock
+constexpr int PONDER_BONUS = 4;            // Ponder on: soft limit + 1/4 (ponder hits repay it)
+
+// Soft limit scaling
+constexpr int EFFORT_MIN_DEPTH = 5;        // Node shares are noise below this depth
+constexpr double EFFORT_BASE = 1.55;       // Effort factor = (BASE - share) * SCALE
+constexpr double EFFORT_SCALE = 1.1;       // share 0.95 -> 0.66, 0.5 -> 1.16, 0.2 -> 1.49
+constexpr double INSTABILITY_WEIGHT = 0.6; // Per (decayed) best-move change
+constexpr double FALLING_WEIGHT = 0.008;   // Per centipawn of score drop
+constexpr double FALLING_MIN = 0.75;
+constexpr double FALLING_MAX = 1.5;
+constexpr double SCALE_MIN = 0.35;
+constexpr double SCALE_MAX = 2.5;
+
+// =============================================================================
+// Time Manager
+// =============================================================================
+
+class TimeManager {
+public:
+    // movetime > 0 fixes both limits; otherwise plan from our clock.
+    // Leaves the manager disabled (no time limit) when neither is given.
+    // 'ponder': the GUI lets us search on the opponent's time.
+    void init(int movetime, int our_time, int our_inc, int moves_to_go, bool ponder = false) {
+        *this = TimeManager();
+
+        if (movetime > 0) {
+            soft = hard = movetime;
+            fixed = true;
+            return;
+        }
+        if (our_time <= 0) return;
+
+        if (moves_to_go > 0) {
+            // Tournament time control: x moves in y minutes
+            // Distribute time evenly with increment bonus
+            int time_for_moves = our_time + our_inc * (moves_to_go - 1) - MOVE_OVERHEAD * moves_to_go;
+            soft = std::max(MIN_THINK_TIME, time_for_moves / moves_to_go);
+            hard = std::min(our_time - MOVE_OVERHEAD, soft * HARD_RATIO_MTG);
+        } else {
+            // Sudden death or increment: assume fewer moves left as the clock runs down
+            int moves_left = MTG_NORMAL;
+            if (our_time > 60000) moves_left = MTG_PLENTY;
+            else if (our_time < 5000) moves_left = MTG_PANIC;
+            else if (our_time < 10000) moves_left = MTG_LOW;
+
+            soft = our_time / moves_left + our_inc * 3 / 4;
+            hard = std::min(static_cast<int>(soft * HARD_RATIO_SUDDEN), our_time / MAX_TIME_FRACTION);
+            hard = std::min(hard, our_time - MOVE_OVERHEAD);
+            soft = std::min(soft, hard);
+        }
+
+        if (ponder) soft = std::min(hard, soft + soft / PONDER_BONUS);
+
+        soft = std::max(soft, MIN_THINK_TIME);
+        hard = std::max(hard, soft);
+    }
+
+    bool enabled() const { return hard > 0; }
+    int soft_limit() const { return soft; }
+    int hard_limit() const { return hard; }
+
+    // Soft limit after the latest scaling, never above the hard limit
+    int scaled_soft_limit() const {
+        return std::min(hard, static_cast<int>(soft * scale));
+    }
+
+    // Feed a completed iteration: 'score' from the side to move, 'effort'
+    // the share of root nodes under 'best_move'. True if the search should
+    // not start another iteration.
+    bool update(int depth, long long elapsed, Move best_move, int score, double effort) {
+        if (!enabled()) return false;
+        if (fixed) return elapsed >= hard;
+
+        best_move_changes *= 0.5;
+        if (iterations > 0 && best_move != prev_best_move) best_move_changes += 1.0;
+
+        double instability = 1.0 + INSTABILITY_WEIGHT * best_move_changes;
+        double falling = (iterations > 0)
+            ? std::clamp(1.0 + (prev_score - score) * FALLING_WEIGHT, FALLING_MIN, FALLING_MAX)
+            : 1.0;
+        double effort_factor = (depth >= EFFORT_MIN_DEPTH) ? (EFFORT_BASE - effort) * EFFORT_SCALE : 1.0;
+
+        scale = std::clamp(effort_factor * instability * falling, SCALE_MIN, SCALE_MAX);
+        prev_best_move = best_move;
+        prev_score = score;
+        iterations++;
+
+        return elapsed >= scaled_soft_limit();
+    }
+
+private:
+    int soft = 0;               // ms, 0 = no time limit
+    int hard = 0;
+    bool fixed = false;         // movetime: use exactly the given time
+    double scale = 1.0;
+    double best_move_changes = 0.0;
+    Move prev_best_move = 0;
+    int prev_score = 0;
+    int iterations = 0;
+};
+
+// =============================================================================
+// Offline Simulator
+// =============================================================================
+//
+// timesim <trace> <clock>...: replays recorded searches against other clocks.
+//
+// A trace is engine output captured with "setoption name TimeTrace value
+// true": one "info string tm depth D time T score S effort E best M" line
+// per completed iteration, each search closed by its "bestmove" line.
+// Record with generous limits (e.g. go movetime 10000); a replay cannot
+// see past the last recorded iteration.
+//
+// Clocks: "base+inc" (sudden death, ms) or "moves/base+inc" (repeating
+// control). Every recorded search is one of our moves, played in order.
+//
+// =============================================================================
+
+struct TraceIteration {
+    int depth;
+    int time;
+    int score;
+    double effort;
+    Move best_move;
+};
+
+using TraceSearch = std::vector<TraceIteration>;
+
+// Moves are only compared, so any injective encoding of "e2e4q" will do
+inline Move trace_move(const std::string& text) {
+    if (text.size() < 4) return 0;
+    int source = (text[0] - 'a') + (8 - (text[1] - '0')) * 8;
+    int target = (text[2] - 'a') + (8 - (text[3] - '0')) * 8;
+    int promotion = (text.size() > 4) ? (std::string("nbrq").find(text[4]) + 1) & 7 : 0;
+    return encode_move(source & 63, target & 63, promotion);
+}
+
+inline std::vector<TraceSearch> load_trace(const char* path) {
+    std::vector<TraceSearch> searches;
+    std::ifstream file(path);
+    std::string line;
+    TraceSearch current;
+
+    while (std::getline(file, line)) {
+        if (line.rfind("bestmove", 0) == 0) {
+            if (!current.empty()) searches.push_back(current);
+            current.clear();
+            continue;
+        }
+        if (line.rfind("info string tm ", 0) != 0) continue;
+
+        std::istringstream in(line.substr(15));
+        std::string key, best;
+        TraceIteration it{};
+        while (in >> key) {
+            if (key == "depth") in >> it.depth;
+            else if (key == "time") in >> it.time;
+            else if (key == "score") in >> it.score;
+            else if (key == "effort") in >> it.effort;
+            else if (key == "best") in >> best;
+        }
+        it.best_move = trace_move(best);
+        current.push_back(it);
+    }
+    return searches;
+}
+
+struct SimClock {
+    int moves = 0;      // Moves per control, 0 = sudden death
+    int base = 0;       // ms
+    int inc = 0;        // ms
+};
+
+inline bool parse_clock(const char* text, SimClock& clock) {
+    clock = SimClock();
+    if (std::strchr(text, '/')) {
+        return std::sscanf(text, "%d/%d+%d", &clock.moves, &clock.base, &clock.inc) >= 2 && clock.base > 0;
+    }
+    return std::sscanf(text, "%d+%d", &clock.base, &clock.inc) >= 1 && clock.base > 0;
+}
+
+// Play every recorded search on 'clock' and print one table row
+inline void simulate(const std::vector<TraceSearch>& searches, const char* label, const SimClock& clock) {
+    long long remaining = clock.base;
+    long long min_left = remaining;
+    long long total_used = 0;
+    int moves_left = clock.moves;
+    int depth_sum = 0, agree = 0, exhausted = 0, flagged = 0;
+
+    for (const TraceSearch& search : searches) {
+        TimeManager tm;
+        tm.init(0, static_cast<int>(remaining), clock.inc, moves_left);
+
+        // Walk the iterations the way the search would: the hard limit cuts
+        // an iteration short, the soft limit stops after one completes
+        const TraceIteration* chosen = nullptr;
+        long long used = -1;
+        for (const TraceIteration& it : search) {
+            if (it.time > tm.hard_limit()) {
+                used = tm.hard_limit();
+                break;
+            }
+            chosen = &it;
+            if (tm.update(it.depth, it.time, it.best_move, it.score, it.effort)) {
+                used = it.time;
+                break;
+            }
+        }
+        if (used < 0) {
+            // The recorded search ended before the simulated one would
+            used = search.back().time;
+            exhausted++;
+        }
+
+        if (chosen) {
+            depth_sum += chosen->depth;
+            if (chosen->best_move == search.back().best_move) agree++;
+        }
+
+        remaining -= used;
+        total_used += used;
+        if (remaining < 0) flagged++;
+        min_left = std::min(min_left, remaining);
+        remaining += clock.inc;
+
+        // Repeating control: a new period's time arrives after the last move
+        if (clock.moves > 0 && --moves_left == 0) {
+            moves_left = clock.moves;
+            remaining += clock.base;
+        }
+    }
+
+    int n = static_cast<int>(searches.size());
+    std::printf("| %-16s | %5d | %8lld | %9lld | %9.2f | %5.1f%% | %7d | %9d |\n",
+        label, n, n ? total_used / n : 0, min_left,
+        n ? static_cast<double>(depth_sum) / n : 0.0,
+        n ? agree * 100.0 / n : 0.0, flagged, exhausted);
+}
+
+inline void run_simulator(const char* path, const std::vector<std::string>& clocks) {
+    std::vector<TraceSearch> searches = load_trace(path);
+    if (searches.empty()) {
+        std::cout << "info string timesim: no \"info string tm\" records in " << path << std::endl;
+        return;
+    }
+
+    std::cout << "\n=== TIME MANAGER SIMULATION ===" << std::endl;
+    std::cout << "Trace: " << path << ", " << searches.size() << " searches\n" << std::endl;
+    std::cout << "| Clock            | Moves | Avg (ms) | Min left  | Avg depth | Agree  | Flagged | Exhausted |" << std::endl;
+    std::cout << "|------------------|-------|----------|-----------|-----------|--------|---------|-----------|" << std::endl;
+
+    for (const std::string& text : clocks) {
+        SimClock clock;
+        if (!parse_clock(text.c_str(), clock)) {
+            std::cout << "info string timesim: bad clock " << text << std::endl;
+            continue;
+        }
+        simulate(searches, text.c_str(), clock);
+    }
+
+    std::cout << "|------------------|-------|----------|-----------|-----------|--------|---------|-----------|" << std::endl;
+    std::cout << "Agree: chosen move equals the deepest recorded best move." << std::endl;
+}
+
+} // namespace TimeMan
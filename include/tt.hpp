@@ -9,11 +9,15 @@
 // - Always-replace with depth preference
 // - Proper bound types (EXACT, ALPHA, BETA)
 // - Mate score adjustment for ply distance
+// - Static evaluation of the position, reused on hits without a cutoff
+// - Lockless entries shared by all search threads
 //
 // =============================================================================
 
 #include "types.hpp"
-#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 
 namespace TT {
 
@@ -100,19 +104,45 @@ enum TTFlag : uint8_t {
     TT_BETA  = 2    // Lower bound (failed high, score >= beta)
 };
 
+// Lockless entry shared by all search threads (same scheme as the perft
+// table): the key is stored XORed with the data word, so an entry torn by
+// a concurrent write fails verification and reads as a miss.
+//
+// Data word: score (bits 0-15), static eval (16-31), depth (32-39),
+// best move (40-55), flag (56-63). Search scores stay within the mate
+// range and fit 16 bits; static evals are clamped, EVAL_NONE is stored as
+// the lowest 16-bit value.
 struct TTEntry {
-    U64 key;        // Zobrist key for verification
-    int score;      // Search score
-    int depth;      // Search depth
-    int best_move;  // Best move found (for move ordering)
-    TTFlag flag;    // Bound type
+    std::atomic<U64> key_xor_data;
+    std::atomic<U64> data;
 };
 
+constexpr int16_t PACKED_EVAL_NONE = INT16_MIN;
+
+inline U64 pack_data(int score, int static_eval, int depth, Move best_move, TTFlag flag) {
+    int16_t eval16 = (static_eval == EVAL_NONE) ? PACKED_EVAL_NONE
+                   : static_cast<int16_t>(std::clamp(static_eval, INT16_MIN + 1, INT16_MAX));
+    return static_cast<U64>(static_cast<uint16_t>(score)) |
+           (static_cast<U64>(static_cast<uint16_t>(eval16)) << 16) |
+           (static_cast<U64>(depth & 0xff) << 32) |
+           (static_cast<U64>(best_move) << 40) |
+           (static_cast<U64>(flag) << 56);
+}
+
+inline int data_score(U64 data)      { return static_cast<int16_t>(static_cast<uint16_t>(data)); }
+inline int data_eval(U64 data) {
+    int16_t eval16 = static_cast<int16_t>(static_cast<uint16_t>(data >> 16));
+    return (eval16 == PACKED_EVAL_NONE) ? EVAL_NONE : eval16;
+}
+inline int data_depth(U64 data)      { return static_cast<int>((data >> 32) & 0xff); }
+inline Move data_move(U64 data)      { return static_cast<Move>(data >> 40); }
+inline TTFlag data_flag(U64 data)    { return static_cast<TTFlag>(data >> 56); }
+
 // =============================================================================
 // Transposition Table
 // =============================================================================
 
-// TT size: 2^20 entries = ~32MB (each entry is ~24 bytes with padding)
+// TT size: 2^20 entries = 16MB (each entry is two 64-bit words)
 constexpr int TT_SIZE_BITS = 20;
 constexpr int TT_SIZE = 1 << TT_SIZE_BITS;
 constexpr int TT_MASK = TT_SIZE - 1;
@@ -120,7 +150,17 @@ constexpr int TT_MASK = TT_SIZE - 1;
 inline TTEntry tt_table[TT_SIZE];
 
 inline void clear() {
-    std::memset(tt_table, 0, sizeof(tt_table));
+    for (int i = 0; i < TT_SIZE; i++) {
+        tt_table[i].key_xor_data.store(0, std::memory_order_relaxed);
+        tt_table[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Data word of the entry for 'key', or false on a miss (or torn entry)
+inline bool read_entry(U64 key, U64& data) {
+    TTEntry& entry = tt_table[key & TT_MASK];
+    data = entry.data.load(std::memory_order_relaxed);
+    return (entry.key_xor_data.load(std::memory_order_relaxed) ^ data) == key;
 }
 
 // =============================================================================
@@ -145,38 +185,48 @@ inline int score_from_tt(int score, int ply) {
 // TT Operations
 // =============================================================================
 
-inline void store(U64 key, int score, int depth, int ply, TTFlag flag, int best_move = 0) {
-    TTEntry& entry = tt_table[key & TT_MASK];
+inline void store(U64 key, int score, int depth, int ply, TTFlag flag, Move best_move = 0,
+                  int static_eval = EVAL_NONE) {
+    U64 old_data;
+    bool same_key = read_entry(key, old_data);
+    
+    // Quiescence results (depth 0) are the lowest tier: they only replace
+    // empty slots and other depth-0 entries
+    if (depth == 0 && data_depth(old_data) > 0) return;
     
-    // Always replace if:
+    // Otherwise always replace if:
     // - Different position (collision)
     // - Same/deeper depth (more valuable search)
     // - Exact score (most valuable)
-    if (entry.key != key || depth >= entry.depth || flag == TT_EXACT) {
-        entry.key = key;
-        entry.score = score_to_tt(score, ply);
-        entry.depth = depth;
-        entry.flag = flag;
-        if (best_move != 0) entry.best_move = best_move;
+    if (!same_key || depth >= data_depth(old_data) || flag == TT_EXACT) {
+        // Keep the old move if this search found none
+        if (best_move == 0 && same_key) best_move = data_move(old_data);
+        if (static_eval == EVAL_NONE && same_key) static_eval = data_eval(old_data);
+        
+        TTEntry& entry = tt_table[key & TT_MASK];
+        U64 data = pack_data(score_to_tt(score, ply), static_eval, depth, best_move, flag);
+        entry.data.store(data, std::memory_order_relaxed);
+        entry.key_xor_data.store(key ^ data, std::memory_order_relaxed);
     }
 }
 
-// Returns: {found, score, best_move}
+// Returns: {found, score, best_move, static_eval}
 // Only returns valid score if depth is sufficient and bounds match
-inline bool probe(U64 key, int depth, int ply, int alpha, int beta, int& score, int& best_move) {
-    TTEntry& entry = tt_table[key & TT_MASK];
-    
-    if (entry.key != key) return false;
+inline bool probe(U64 key, int depth, int ply, int alpha, int beta, int& score, Move& best_move,
+                  int& static_eval) {
+    U64 data;
+    if (!read_entry(key, data)) return false;
     
-    // Always return best move for move ordering, even if depth insufficient
-    best_move = entry.best_move;
+    // Always return best move (for move ordering) and static eval, even if depth insufficient
+    best_move = data_move(data);
+    static_eval = data_eval(data);
     
     // Only use score if depth is sufficient
-    if (entry.depth < depth) return false;
+    if (data_depth(data) < depth) return false;
     
-    int tt_score = score_from_tt(entry.score, ply);
+    int tt_score = score_from_tt(data_score(data), ply);
     
-    switch (entry.flag) {
+    switch (data_flag(data)) {
         case TT_EXACT:
             score = tt_score;
             return true;
@@ -202,9 +252,9 @@ inline bool probe(U64 key, int depth, int ply, int alpha, int beta, int& score,
 }
 
 // Get TT move for move ordering (doesn't require depth match)
-inline int get_tt_move(U64 key) {
-    TTEntry& entry = tt_table[key & TT_MASK];
-    return (entry.key == key) ? entry.best_move : 0;
+inline Move get_tt_move(U64 key) {
+    U64 data;
+    return read_entry(key, data) ? data_move(data) : 0;
 }
 
 } // namespace TT
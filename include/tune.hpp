@@ -0,0 +1,78 @@
+#pragma once
+
+// =============================================================================
+// Batu Chess Engine - Search Parameter Registry
+// =============================================================================
+//
+// Search constants are declared with TUNABLE(name, value, min, max):
+//   - Normal build: a constexpr int, exactly as before
+//   - Tuning build (-DBATU_TUNE, CMake option BATU_TUNE): a variable listed
+//     in the registry below. The UCI layer exposes every entry as a spin
+//     option named after the constant, and the spsa command tunes them all.
+//
+// TUNABLE_REBUILD also names a function that rebuilds the tables derived from
+// the value (e.g. init_lmr); it runs whenever the value changes.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace Tune {
+
+struct Param {
+    const char* name;
+    int* value;
+    int default_value;
+    int min;
+    int max;
+    void (*rebuild)();      // Recomputes derived tables (nullptr: none)
+};
+
+// Function-local static: parameters register during static initialization
+inline std::vector<Param>& params() {
+    static std::vector<Param> registry;
+    return registry;
+}
+
+inline int add(const char* name, int* value, int default_value, int min, int max,
+               void (*rebuild)() = nullptr) {
+    params().push_back({name, value, default_value, min, max, rebuild});
+    return default_value;
+}
+
+inline Param* find(const std::string& name) {
+    for (Param& param : params()) {
+        if (name == param.name) return &param;
+    }
+    return nullptr;
+}
+
+// Set a parameter, clamped to its range, rebuilding its derived tables
+inline void set(Param& param, int value) {
+    value = std::clamp(value, param.min, param.max);
+    if (*param.value == value) return;
+    *param.value = value;
+    if (param.rebuild) param.rebuild();
+}
+
+// By name; false if there is no such parameter
+inline bool set(const std::string& name, int value) {
+    Param* param = find(name);
+    if (!param) return false;
+    set(*param, value);
+    return true;
+}
+
+} // namespace Tune
+
+#ifdef BATU_TUNE
+#define TUNABLE(name, value, min, max) \
+    inline int name = Tune::add(#name, &name, value, min, max)
+#define TUNABLE_REBUILD(name, value, min, max, rebuild) \
+    inline int name = Tune::add(#name, &name, value, min, max, rebuild)
+#else
+#define TUNABLE(name, value, min, max) constexpr int name = value
+#define TUNABLE_REBUILD(name, value, min, max, rebuild) constexpr int name = value
+#endif
@@ -18,8 +18,9 @@ using U64 = unsigned long long;
 // =============================================================================
 
 constexpr int BOARD_SIZE = 8;
-constexpr int MAX_MOVES = 256;
+constexpr int MAX_MOVES = 256;     // Move list capacity (218 is the most legal moves in any position)
 constexpr int MAX_MOVE_STRING = 6;  // e.g., "e7e8q\0"
+constexpr int MAX_GAME_PLY = 2048;  // Undo stack depth (game history + search path)
 
 // =============================================================================
 // Side Constants
@@ -36,6 +37,8 @@ constexpr int BOTH = 2;
 constexpr int INFINITY_SCORE = 999999;
 constexpr int CHECKMATE_SCORE = 11111;
 constexpr int STALEMATE_SCORE = 0;
+constexpr int DRAW_SCORE = 0;       // Repetition and fifty-move rule
+constexpr int EVAL_NONE = INFINITY_SCORE + 1;  // No static eval (in check, or not computed)
 
 // =============================================================================
 // Bitboard Masks
@@ -65,14 +68,14 @@ enum Square {
 enum Piece { P, R, N, B, Q, K, p, r, n, b, q, k, NO_PIECE };
 enum SlidingPiece { ROOK, BISHOP };
 enum Castling { WK = 1, WQ = 2, BK = 4, BQ = 8 };
-enum MoveType { ALL_MOVES, ONLY_CAPTURES };
+enum MoveType { ALL_MOVES, ONLY_CAPTURES, ONLY_QUIETS };
 
 // =============================================================================
 // Bitboard Macros
 // =============================================================================
 
-#define get_bit(bitboard, square) ((bitboard & (1ULL << square)) ? 1 : 0)
-#define set_bit(bitboard, square) (bitboard |= (1ULL << square))
+#define get_bit(bitboard, square) (((bitboard) & (1ULL << (square))) ? 1 : 0)
+#define set_bit(bitboard, square) ((bitboard) |= (1ULL << (square)))
 #define pop_bit(bitboard, square) ((bitboard) &= ~(1ULL << (square)))
 
 // =============================================================================
@@ -80,54 +83,71 @@ enum MoveType { ALL_MOVES, ONLY_CAPTURES };
 // =============================================================================
 
 /*
-    Move encoding (25 bits):
-    0000 0000 0000 0000 0011 1111   source square       0x3f
-    0000 0000 0000 0000 1111 1100   target square       0xfc0
-    0000 0000 0000 1111 0000 0000   piece               0xf000
-    0000 0000 1111 0000 0000 0000   promoted piece      0xf0000
-    0000 0001 0000 0000 0000 0000   capture flag        0x100000
-    0000 0010 0000 0000 0000 0000   double pawn flag    0x200000
-    0000 0100 0000 0000 0000 0000   enpassant flag      0x400000
-    0000 1000 0000 0000 0000 0000   castling flag       0x800000
-    0001 0000 0000 0000 0000 0000   checking flag       0x1000000
+    Move encoding (16 bits):
+    0000 0000 0011 1111   source square       0x3f
+    0000 1111 1100 0000   target square       0xfc0
+    1111 0000 0000 0000   flags               0xf000
+
+    Flags: bit 14 = capture, bit 15 = promotion, low 2 bits = promotion piece
+       0  quiet                  8-11  promotion to N, B, R, Q
+       1  double pawn push      12-15  capture-promotion to N, B, R, Q
+       2  king side castle
+       3  queen side castle
+       4  capture
+       5  en passant capture
+
+    The moving and captured pieces are not stored: read them from the board.
+    Move 0 (a8a8 quiet) is never legal and means "no move".
 */
 
-#define encode_move(source, target, piece, promoted, capture, doublepawn, enpassant, castling, checking) \
-    ((source) | ((target) << 6) | ((piece) << 12) | ((promoted) << 16) | \
-     ((capture) << 20) | ((doublepawn) << 21) | ((enpassant) << 22) | \
-     ((castling) << 23) | ((checking) << 24))
+using Move = uint16_t;
+
+enum MoveFlag {
+    FLAG_QUIET = 0,
+    FLAG_DOUBLE_PUSH = 1,
+    FLAG_KING_CASTLE = 2,
+    FLAG_QUEEN_CASTLE = 3,
+    FLAG_CAPTURE = 4,
+    FLAG_ENPASSANT = 5,
+    FLAG_PROMOTION = 8,         // + 0..3 (N, B, R, Q)
+    FLAG_PROMO_CAPTURE = 12     // + 0..3 (N, B, R, Q)
+};
+
+// Promotion piece by the low two flag bits (white piece types)
+constexpr int PROMOTION_PIECES[4] = { N, B, R, Q };
+
+#define encode_move(source, target, flags) \
+    static_cast<Move>((source) | ((target) << 6) | ((flags) << 12))
 
 #define get_move_source(move)    ((move) & 0x3f)
 #define get_move_target(move)    (((move) & 0xfc0) >> 6)
-#define get_move_piece(move)     (((move) & 0xf000) >> 12)
-#define get_move_promoted(move)  (((move) & 0xf0000) >> 16)
-#define get_move_capture(move)   ((move) & 0x100000)
-#define get_move_doublepawn(move)((move) & 0x200000)
-#define get_move_enpassant(move) ((move) & 0x400000)
-#define get_move_castling(move)  ((move) & 0x800000)
-#define get_move_checking(move)  ((move) & 0x1000000)
+#define get_move_flags(move)     (((move) & 0xf000) >> 12)
+#define get_move_capture(move)   ((move) & 0x4000)
+#define get_move_promotion(move) ((move) & 0x8000)
+#define get_move_doublepawn(move)(get_move_flags(move) == FLAG_DOUBLE_PUSH)
+#define get_move_enpassant(move) (get_move_flags(move) == FLAG_ENPASSANT)
+#define get_move_castling(move)  ((get_move_flags(move) & 0xe) == FLAG_KING_CASTLE)
+
+// Promoted piece as a white piece type (N, B, R, Q), 0 if not a promotion
+#define get_move_promoted(move)  (get_move_promotion(move) ? PROMOTION_PIECES[get_move_flags(move) & 3] : 0)
 
 // =============================================================================
 // Move List Structure
 // =============================================================================
 
+struct ScoredMove {
+    Move move;
+    int score;      // Ordering score (lower = better)
+};
+
 struct MoveList {
-    int moves[MAX_MOVES];
-    int scores[MAX_MOVES];
-    int score_guess[MAX_MOVES];
-    bool legality[MAX_MOVES];
+    ScoredMove moves[MAX_MOVES];
     int count;
     
     MoveList() : count(0) {}
     
-    void add(int move) {
-        moves[count] = move;
-        count++;
-    }
-    
-    void add_scored(int move, int score) {
-        moves[count] = move;
-        scores[count] = score;
+    void add(Move move) {
+        moves[count].move = move;
         count++;
     }
 };
@@ -239,6 +259,12 @@ inline char promoted_to_char(int piece) {
 inline const char* START_POSITION = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 inline const char* KIWIPETE_POSITION = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -";
 
+// Perft test positions (chessprogramming.org "Perft Results" positions 3-6)
+inline const char* PERFT_POSITION_3 = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1";
+inline const char* PERFT_POSITION_4 = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1";
+inline const char* PERFT_POSITION_5 = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
+inline const char* PERFT_POSITION_6 = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
+
 // Benchmark positions (eval test + mate puzzles)
 inline const char* BENCH_EVAL_TEST = "K1B5/P2r4/1p1r1n2/4k3/8/3PPP2/8/8 w - - 0 1";           // SF: -6.0
 inline const char* BENCH_MATE_IN_2_A = "1q4b1/8/N2n1NQ1/2P2p2/B1k2rRr/1p1Rp2p/4K3/B7 w - - 0 1";
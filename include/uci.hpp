@@ -5,15 +5,32 @@
 // =============================================================================
 
 #include "position.hpp"
+#include "attacks.hpp"
 #include "search.hpp"
 #include "nn_eval.hpp"
+#include "perft.hpp"
+#include "timeman.hpp"
+#include "spsa.hpp"
 #include <iostream>
 #include <cstring>
 #include <cstdio>
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // UCI Options
 inline bool UseNN = true;  // Use neural network evaluation when available
+inline int Threads = 1;    // Search threads (main + Lazy SMP helpers)
+inline bool Deterministic = false;  // Reproducible searches: one thread, fresh TT at every go
+inline bool TimeTrace = false;      // Print per-iteration time manager input (for timesim)
+inline int MultiPV = 1;             // Root moves reported with an exact score and PV
+inline bool Ponder = false;         // GUI searches on the opponent's time ("go ponder")
+inline int EvalCacheMB = EvalCache::DEFAULT_MB;  // Eval cache size (0 = off)
 
 namespace UCI {
 
@@ -21,7 +38,7 @@ namespace UCI {
 // Move Parsing
 // =============================================================================
 
-inline int parse_move(Position& pos, const char* move_string) {
+inline Move parse_move(Position& pos, const char* move_string) {
     MoveList moves;
     pos.generate_moves(moves);
     
@@ -29,17 +46,11 @@ inline int parse_move(Position& pos, const char* move_string) {
     int target = (move_string[2] - 'a') + (8 - (move_string[3] - '0')) * 8;
     
     for (int i = 0; i < moves.count; i++) {
-        int move = moves.moves[i];
+        Move move = moves.moves[i].move;
         
         if (source == get_move_source(move) && target == get_move_target(move)) {
-            int promoted = get_move_promoted(move);
-            
-            if (promoted) {
-                char promo_char = move_string[4];
-                if ((promoted == Q || promoted == q) && promo_char == 'q') return move;
-                if ((promoted == R || promoted == r) && promo_char == 'r') return move;
-                if ((promoted == B || promoted == b) && promo_char == 'b') return move;
-                if ((promoted == N || promoted == n) && promo_char == 'n') return move;
+            if (get_move_promotion(move)) {
+                if (promoted_to_char(get_move_promoted(move)) == move_string[4]) return move;
                 continue;
             }
             return move;
@@ -73,10 +84,11 @@ inline void parse_position(Position& pos, char* command) {
         moves += 6;
         
         while (*moves) {
-            int move = parse_move(pos, moves);
+            Move move = parse_move(pos, moves);
             if (move == 0) break;
             
             pos.make_move(move, ALL_MOVES);
+            pos.trim_history();
             
             while (*moves && *moves != ' ') moves++;
             moves++;
@@ -87,17 +99,36 @@ inline void parse_position(Position& pos, char* command) {
 }
 
 // =============================================================================
-// Go Command - Adaptive Time Management
+// Search Limits and Shared Search State
+// =============================================================================
+
+struct SearchLimits {
+    int max_depth = 64;
+    TimeMan::TimeManager time;  // Soft/hard limits (disabled = no time limit)
+    U64 nodes = 0;          // Node budget over all threads (0 = none)
+    int mate = 0;           // Stop once a mate in this many moves is proven (0 = off)
+    bool infinite = false;  // Search until "stop"
+    bool ponder = false;    // Search on the opponent's time until "ponderhit" or "stop"
+};
+
+inline std::thread search_thread;
+inline SearchLimits active_limits;              // Limits of the running search
+inline std::atomic<bool> pondering{false};
+inline std::atomic<long long> search_start_ms{0};
+inline std::mutex output_mutex;                 // Keeps info/bestmove/readyok lines whole
+
+inline void start_search(Position& pos, const SearchLimits& limits);
+
+// =============================================================================
+// Go Command
 // =============================================================================
 
 inline void parse_go(Position& pos, char* command) {
     int max_depth = 64;
-    int optimal_time = 0;   // Target time to use
-    int maximum_time = 0;   // Hard limit (don't exceed)
+    int movetime = 0;
     int our_time = 0;
     int our_inc = 0;
     int moves_to_go = 0;
-    constexpr int MOVE_OVERHEAD = 50;  // Safety margin in ms
     
     // Parse depth limit
     char* depth_str = std::strstr(command, "depth");
@@ -108,8 +139,7 @@ inline void parse_go(Position& pos, char* command) {
     // Parse movetime (fixed time per move)
     char* movetime_str = std::strstr(command, "movetime");
     if (movetime_str != nullptr) {
-        optimal_time = std::atoi(movetime_str + 9);
-        maximum_time = optimal_time;
+        movetime = std::atoi(movetime_str + 9);
     }
     
     // Parse movestogo (moves until next time control)
@@ -134,148 +164,256 @@ inline void parse_go(Position& pos, char* command) {
         if (binc_str) our_inc = std::atoi(binc_str + 5);
     }
     
-    // Calculate time for this move (only if not already set by movetime)
-    if (our_time > 0 && optimal_time == 0) {
-        if (moves_to_go > 0) {
-            // Tournament time control: x moves in y minutes
-            // Distribute time evenly with increment bonus
-            int time_for_moves = our_time + our_inc * (moves_to_go - 1) - MOVE_OVERHEAD * moves_to_go;
-            optimal_time = std::max(10, time_for_moves / moves_to_go);
-            maximum_time = std::min(our_time - MOVE_OVERHEAD, optimal_time * 3);
-        } else {
-            // Sudden death or increment time control
-            // Adaptive scaling based on remaining time
-            int base_moves = 30;  // Assume ~30 moves left on average
-            
-            // Scale based on remaining time (use more time early, less when low)
-            if (our_time > 60000) {
-                base_moves = 40;  // Plenty of time, be conservative
-            } else if (our_time < 10000) {
-                base_moves = 20;  // Low on time, move faster
-            } else if (our_time < 5000) {
-                base_moves = 15;  // Very low, panic mode
-            }
-            
-            // Calculate optimal time with increment bonus
-            optimal_time = our_time / base_moves + our_inc * 3 / 4;
-            
-            // Maximum time: can extend up to 2.5x optimal, but capped
-            maximum_time = optimal_time * 5 / 2;
-            
-            // Never use more than 20% of remaining time in one move
-            maximum_time = std::min(maximum_time, our_time / 5);
-            
-            // Safety: always leave some buffer
-            maximum_time = std::min(maximum_time, our_time - MOVE_OVERHEAD);
-            optimal_time = std::min(optimal_time, maximum_time);
-        }
-        
-        // Minimum time bounds
-        optimal_time = std::max(optimal_time, 10);
-        maximum_time = std::max(maximum_time, optimal_time);
+    SearchLimits limits;
+    limits.max_depth = max_depth;
+    limits.infinite = (std::strstr(command, "infinite") != nullptr);
+    
+    // Soft/hard limits for this move (none for infinite: just depth)
+    if (!limits.infinite)
+        limits.time.init(movetime, our_time, our_inc, moves_to_go, Ponder);
+    
+    // Parse nodes (budget enforced inside the search) and mate (moves, not plies)
+    char* nodes_str = std::strstr(command, "nodes");
+    if (nodes_str != nullptr) {
+        limits.nodes = std::strtoull(nodes_str + 6, nullptr, 10);
+    }
+    char* mate_str = std::strstr(command, "mate");
+    if (mate_str != nullptr) {
+        limits.mate = std::atoi(mate_str + 5);
+    }
+    
+    limits.ponder = (std::strstr(command, "ponder") != nullptr);
+    start_search(pos, limits);
+}
+
+// =============================================================================
+// Search Thread
+// =============================================================================
+//
+// "go" hands the search to a worker thread so the UCI loop keeps reading
+// stop, ponderhit, isready and quit. The time manager's hard limit is
+// enforced inside the search (Search::deadline_ms); its soft limit is
+// checked after every iteration.
+//
+// =============================================================================
+
+// UCI move text ("e7e8q"), without print_move's padding
+inline std::string move_to_uci(Move move) {
+    std::string text = std::string(SQUARE_TO_COORD[get_move_source(move)]) + SQUARE_TO_COORD[get_move_target(move)];
+    if (get_move_promotion(move)) text += promoted_to_char(get_move_promoted(move));
+    return text;
+}
+
+// "cp N", or "mate N" in moves (negative when the engine is getting mated);
+// 'score' is from White's point of view, reported from the side to move's
+inline void print_score(int score, int side) {
+    if (side == BLACK) score = -score;
+    if (std::abs(score) > CHECKMATE_SCORE - Search::MATE_SCORE_MARGIN) {
+        int mate_in = (CHECKMATE_SCORE - std::abs(score) + 1) / 2;
+        std::cout << "mate " << (score > 0 ? mate_in : -mate_in);
+    } else {
+        std::cout << "cp " << score;
     }
+}
+
+// One info line per reported root move: the best one, or the top MultiPV
+// lines with their exact scores (caller holds output_mutex)
+inline void print_pv_lines(const Search::ThreadData& td, int side, int depth, U64 nodes, long long search_ms) {
+    size_t lines = std::min<size_t>(td.multi_pv, td.root_moves.size());
     
-    // Parse infinite (no time limit, just depth)
-    if (std::strstr(command, "infinite")) {
-        optimal_time = 0;
-        maximum_time = 0;
+    for (size_t i = 0; i < lines; i++) {
+        const Search::RootMove& root_move = td.root_moves[i];
+        if (std::abs(root_move.score) == INFINITY_SCORE) break;  // Failed low: no exact score
+        
+        std::cout << "info depth " << depth;
+        if (td.multi_pv > 1) std::cout << " multipv " << (i + 1);
+        std::cout << " score ";
+        print_score(root_move.score, side);
+        std::cout << " nodes " << nodes << " time " << search_ms;
+        if (search_ms > 0) {
+            std::cout << " nps " << (nodes * 1000 / search_ms);
+        }
+        std::cout << " pv";
+        for (Move move : root_move.pv)
+            std::cout << ' ' << move_to_uci(move);
+        std::cout << std::endl;
     }
+}
+
+// Expected reply to 'best_move', searched by "go ponder" on the opponent's
+// time: the second move of its PV, or the TT move of the position after it
+// when the PV stops short (e.g. at a TT cutoff)
+inline Move ponder_move(Position& pos, const Search::ThreadData& td, Move best_move) {
+    if (!best_move) return 0;
+    if (!td.root_moves.empty() && td.root_moves[0].move == best_move && td.root_moves[0].pv.size() >= 2)
+        return td.root_moves[0].pv[1];
     
+    pos.make_move(best_move, ALL_MOVES);
+    Move reply = TT::get_tt_move(pos.hash);
+    if (reply && !pos.is_move_legal(reply)) reply = 0;
+    pos.unmake_move();
+    return reply;
+}
+
+inline void think(Position& pos, SearchLimits limits) {
+    long long go_start = search_start_ms.load();   // Stays put on ponderhit, unlike search_start_ms
     pos.nodes = 0;
-    int best_move = 0;
-    int best_score = 0;
-    int prev_best_move = 0;
-    int prev_score = 0;
-    int stable_count = 0;
-    auto start = std::chrono::high_resolution_clock::now();
+    Move best_move = 0;
+    TimeMan::TimeManager& time_manager = limits.time;
     
-    // Clear killer moves for new search
-    Search::clear_killers();
+    // Fresh per-thread state (killers) for the main thread; helpers share the TT
+    std::unique_ptr<Search::ThreadData> main_td(new Search::ThreadData());
+    main_td->multi_pv = MultiPV;
+    Search::SearchThreads helpers;
+    helpers.start(pos, Deterministic ? 0 : Threads - 1, limits.max_depth);
     
-    // Iterative deepening loop
-    for (int depth = 1; depth <= max_depth; depth++) {
-        MoveList moves = Search::search(pos, depth);
-        best_move = Search::find_best_move(pos, moves);
-        
-        // Find the score of best move
-        for (int i = 0; i < moves.count; i++) {
-            if (moves.moves[i] == best_move) {
-                best_score = moves.scores[i];
-                break;
-            }
+    // Iterative deepening loop (root moves keep their order between iterations)
+    main_td->root_moves = Search::generate_root_moves(*main_td, pos);
+    bool interrupted = false;
+    for (int depth = 1; depth <= limits.max_depth; depth++) {
+        if (!Search::search_iteration(*main_td, pos, depth)) {
+            interrupted = true;
+            break;
         }
+        best_move = main_td->best_move;
         
-        // Track best move stability for time management
-        if (best_move == prev_best_move) {
-            stable_count++;
-        } else {
-            stable_count = 0;
-        }
-        prev_best_move = best_move;
+        // Share of this iteration's root nodes spent under the best move
+        U64 root_nodes = 0;
+        for (const Search::RootMove& root_move : main_td->root_moves)
+            root_nodes += root_move.nodes;
+        double effort = root_nodes ? static_cast<double>(main_td->root_moves[0].nodes) / root_nodes : 1.0;
         
-        auto now = std::chrono::high_resolution_clock::now();
-        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+        long long now = Search::now_ms();
+        long long elapsed_ms = now - search_start_ms.load();
+        long long search_ms = now - go_start;
         
         // Output info
-        std::cout << "info depth " << depth 
-                  << " score cp " << best_score
-                  << " nodes " << pos.nodes 
-                  << " time " << elapsed_ms;
-        if (elapsed_ms > 0) {
-            std::cout << " nps " << (pos.nodes * 1000 / elapsed_ms);
+        {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            print_pv_lines(*main_td, pos.side, depth, pos.nodes + helpers.nodes(), search_ms);
         }
-        std::cout << std::endl;
         
-        // Time management decisions
-        if (optimal_time > 0) {
-            // Hard stop: never exceed maximum time
-            if (elapsed_ms >= maximum_time) {
-                break;
-            }
-            
-            // Calculate adjusted optimal time based on:
-            // 1. Best move stability (stable = use less time)
-            // 2. Score drop (dropping = use more time)
-            double time_factor = 1.0;
-            
-            // Stability factor: if best move is stable, reduce time
-            if (stable_count >= 4) {
-                time_factor *= 0.6;  // Very stable, save time
-            } else if (stable_count >= 2) {
-                time_factor *= 0.8;  // Somewhat stable
-            }
-            
-            // Score drop factor: if score is falling, use more time
-            if (depth > 1) {
-                int score_drop = prev_score - best_score;
-                if (score_drop > 50) {
-                    time_factor *= 1.3;  // Significant drop, think more
-                } else if (score_drop > 20) {
-                    time_factor *= 1.15;
-                }
-            }
-            prev_score = best_score;
-            
-            int adjusted_optimal = static_cast<int>(optimal_time * time_factor);
-            
-            // Stop if we've exceeded adjusted optimal time
-            if (elapsed_ms >= adjusted_optimal) {
-                break;
-            }
-            
-            // Estimate if next iteration would exceed maximum
-            // (branching factor ~2-3, next depth takes ~2.5x current)
-            if (depth >= 4 && elapsed_ms * 3 > maximum_time) {
-                break;
-            }
+        // go mate N: a mate in N moves is 2N-1 plies from the root
+        if (limits.mate > 0 && main_td->score >= CHECKMATE_SCORE - (2 * limits.mate - 1)) {
+            break;
+        }
+        
+        if (TimeTrace) {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << "info string tm depth " << depth << " time " << elapsed_ms
+                      << " score " << main_td->score << " effort " << effort << " best ";
+            Position::print_move(best_move);
+            std::cout << std::endl;
         }
+        
+        // Soft limit (none while pondering: the clock starts at ponderhit, but
+        // the manager still tracks stability so the work carries over)
+        bool soft_stop = time_manager.update(depth, elapsed_ms, best_move, main_td->score, effort);
+        if (soft_stop && !pondering.load()) {
+            break;
+        }
+    }
+    
+    // "go infinite" and "go ponder" may not answer before stop/ponderhit
+    while (!Search::stop_search.load() && (limits.infinite || pondering.load()))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    
+    // Stop the helpers and take the most trustworthy thread's move (the last
+    // completed iteration, or partial root results if the first was cut short)
+    helpers.stop();
+    const Search::ThreadData& best = helpers.best(*main_td);
+    best_move = best.best_move;
+    Move ponder = ponder_move(pos, best, best_move);
+    
+    std::lock_guard<std::mutex> lock(output_mutex);
+    
+    // Totals of the interrupted iteration (node-limited runs compare these)
+    if (interrupted) {
+        std::cout << "info nodes " << (pos.nodes + helpers.nodes())
+                  << " time " << (Search::now_ms() - go_start) << std::endl;
     }
     
-    std::cout << "bestmove ";
-    Position::print_move(best_move);
+    std::cout << "bestmove " << move_to_uci(best_move);
+    if (ponder) std::cout << " ponder " << move_to_uci(ponder);
     std::cout << std::endl;
 }
 
+// Stop a running search and wait for its bestmove
+inline void stop_search_thread() {
+    if (search_thread.joinable()) {
+        Search::stop_search.store(true);
+        search_thread.join();
+    }
+}
+
+inline void start_search(Position& pos, const SearchLimits& limits) {
+    stop_search_thread();
+    
+    // Deterministic mode: every search starts from the same (empty) table
+    if (Deterministic) TT::clear();
+    
+    long long start = Search::now_ms();
+    active_limits = limits;
+    pondering.store(limits.ponder);
+    search_start_ms.store(start);
+    Search::set_limits((limits.time.enabled() && !limits.ponder) ? start + limits.time.hard_limit() : 0,
+                       limits.nodes);
+    
+    search_thread = std::thread(think, std::ref(pos), limits);
+}
+
+// The opponent played the expected move: keep searching on our own clock
+inline void ponder_hit() {
+    long long start = Search::now_ms();
+    search_start_ms.store(start);
+    if (active_limits.time.enabled())
+        Search::deadline_ms.store(start + active_limits.time.hard_limit());
+    pondering.store(false);
+}
+
+// =============================================================================
+// Fixed-Depth Search (benchmarks)
+// =============================================================================
+
+struct SearchResult {
+    Move best_move;
+    int score;      // From White's point of view
+    U64 nodes;      // All threads
+    U64 cutoffs;    // Main thread beta cutoffs
+    U64 first_move_cutoffs;
+    U64 eval_calls; // Main thread evaluation statistics (see ThreadData)
+    U64 eval_cache_hits;
+    U64 tt_evals;
+};
+
+// Iterative deepening to 'depth' on 'num_threads' threads, no time limit
+inline SearchResult search_to_depth(Position& pos, int depth, int num_threads) {
+    pos.nodes = 0;
+    Search::set_limits(0, 0);
+    
+    std::unique_ptr<Search::ThreadData> main_td(new Search::ThreadData());
+    Search::SearchThreads helpers;
+    helpers.start(pos, num_threads - 1, depth);
+    
+    main_td->root_moves = Search::generate_root_moves(*main_td, pos);
+    for (int d = 1; d <= depth; d++)
+        Search::search_iteration(*main_td, pos, d);
+    
+    helpers.stop();
+    const Search::ThreadData& best = helpers.best(*main_td);
+    
+    SearchResult result;
+    result.best_move = best.best_move;
+    result.score = (pos.side == WHITE) ? best.score : -best.score;
+    result.nodes = pos.nodes + helpers.nodes();
+    result.cutoffs = main_td->cutoffs;
+    result.first_move_cutoffs = main_td->first_move_cutoffs;
+    result.eval_calls = main_td->eval_calls;
+    result.eval_cache_hits = main_td->eval_cache_hits;
+    result.tt_evals = main_td->tt_evals;
+    return result;
+}
+
 // =============================================================================
 // Benchmark Command
 // =============================================================================
@@ -298,8 +436,9 @@ inline void run_benchmark(Position& pos) {
     int num_positions = sizeof(positions) / sizeof(positions[0]);
     
     std::cout << "\n=== BATU CHESS ENGINE BENCHMARK ===" << std::endl;
-    std::cout << "Config: Alpha-Beta + TT + NMP + LMR + Killers";
-    std::cout << (UseNN && NN::nn_loaded ? " + NN Eval" : " + Static Eval") << "\n" << std::endl;
+    std::cout << "Config: Alpha-Beta + TT + NMP + LMR + Killers + History";
+    std::cout << (UseNN && NN::nn_loaded ? " + NN Eval" : " + Static Eval");
+    std::cout << ", Attacks: " << AttackTables::slider_backend_name(slider_backend) << "\n" << std::endl;
     
     // Table header
     std::cout << "| Position             | Depth | Time(ms) | Nodes      | Score  | Best Move | Status |" << std::endl;
@@ -307,37 +446,38 @@ inline void run_benchmark(Position& pos) {
     
     long long total_nodes = 0;
     long long total_time = 0;
+    U64 total_cutoffs = 0;
+    U64 total_first_cutoffs = 0;
+    U64 total_eval_calls = 0;
+    U64 total_eval_cache_hits = 0;
+    U64 total_tt_evals = 0;
     int passed = 0;
     
     for (int i = 0; i < num_positions; i++) {
         // Clear state (same as ucinewgame)
         TT::clear();
-        Search::clear_killers();
+        EvalCache::clear();
         
         pos.parse_fen(positions[i].fen);
-        pos.nodes = 0;
         
         auto start = std::chrono::high_resolution_clock::now();
         
-        // Iterative deepening (same as parse_go)
-        int best_move = 0;
-        int best_score = 0;
-        for (int depth = 1; depth <= positions[i].depth; depth++) {
-            MoveList moves = Search::search(pos, depth);
-            best_move = Search::find_best_move(pos, moves);
-            for (int j = 0; j < moves.count; j++) {
-                if (moves.moves[j] == best_move) {
-                    best_score = moves.scores[j];
-                    break;
-                }
-            }
-        }
+        // Iterative deepening with aspiration windows (same as parse_go),
+        // single-threaded so the node count is reproducible
+        SearchResult result = search_to_depth(pos, positions[i].depth, 1);
+        Move best_move = result.best_move;
+        int best_score = result.score;
         
         auto end = std::chrono::high_resolution_clock::now();
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         
-        total_nodes += pos.nodes;
+        total_nodes += result.nodes;
         total_time += ms;
+        total_cutoffs += result.cutoffs;
+        total_first_cutoffs += result.first_move_cutoffs;
+        total_eval_calls += result.eval_calls;
+        total_eval_cache_hits += result.eval_cache_hits;
+        total_tt_evals += result.tt_evals;
         
         // Invariant checks:
         // 1. Best move must be non-zero (engine didn't crash)
@@ -365,7 +505,7 @@ inline void run_benchmark(Position& pos) {
         
         // Print table row
         std::printf("| %-20s | %5d | %8lld | %10ld | %6s | %-9s | %s |\n",
-            positions[i].name, positions[i].depth, (long long)ms, pos.nodes,
+            positions[i].name, positions[i].depth, (long long)ms, (long)result.nodes,
             score_str, move_str, test_passed ? "PASS" : "FAIL");
     }
     
@@ -379,18 +519,26 @@ inline void run_benchmark(Position& pos) {
     }
     std::cout << std::endl;
     
+    // Move ordering quality: share of beta cutoffs produced by the first move
+    if (total_cutoffs > 0) {
+        std::printf("Move ordering: %llu beta cutoffs, %.1f%% on the first move\n",
+            (unsigned long long)total_cutoffs, 100.0 * total_first_cutoffs / total_cutoffs);
+    }
+    
+    // Evaluation cost: full evaluations per node, and where the others came from
+    if (total_nodes > 0 && total_eval_calls > 0) {
+        U64 evaluations = total_eval_calls - total_eval_cache_hits;
+        std::printf("Evaluation: %.2f evaluations per node, eval cache hit rate %.1f%%, %llu evals from the TT\n",
+            (double)evaluations / total_nodes, 100.0 * total_eval_cache_hits / total_eval_calls,
+            (unsigned long long)total_tt_evals);
+    }
+    
     // TT reuse test: run first position again, should be faster
     std::cout << "\nTT Reuse Test (re-run pos 1 without clearing TT):" << std::endl;
     pos.parse_fen(positions[0].fen);
-    pos.nodes = 0;
-    Search::clear_killers();  // Clear killers but NOT TT
     
     auto start2 = std::chrono::high_resolution_clock::now();
-    int best_move2 = 0;
-    for (int depth = 1; depth <= positions[0].depth; depth++) {
-        MoveList moves = Search::search(pos, depth);
-        best_move2 = Search::find_best_move(pos, moves);
-    }
+    search_to_depth(pos, positions[0].depth, 1);  // Fresh killers, NOT a fresh TT
     auto end2 = std::chrono::high_resolution_clock::now();
     auto ms2 = std::chrono::duration_cast<std::chrono::milliseconds>(end2 - start2).count();
     
@@ -398,36 +546,467 @@ inline void run_benchmark(Position& pos) {
     std::cout << "  TT reuse run (pos 1 only): " << ms2 << " ms, " << pos.nodes << " nodes" << std::endl;
 }
 
+// =============================================================================
+// Thread Scaling Benchmark
+// =============================================================================
+//
+// bench threads [N]: searches a few middlegame positions to a fixed depth
+// with 1, 2, 4, 8... threads up to N (default: hardware threads) and
+// reports time to depth and nps relative to one thread.
+//
+// =============================================================================
+
+inline void run_thread_benchmark(Position& pos, int max_threads) {
+    struct ScalingPosition {
+        const char* fen;
+        int depth;
+    };
+    
+    const ScalingPosition positions[] = {
+        { START_POSITION, 12 },
+        { KIWIPETE_POSITION, 9 },
+        { PERFT_POSITION_6, 9 }
+    };
+    
+    if (max_threads <= 0)
+        max_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    max_threads = std::min(max_threads, Search::MAX_THREADS);
+    
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+    
+    std::cout << "\n=== THREAD SCALING BENCHMARK ===" << std::endl;
+    std::cout << "Lazy SMP, " << (sizeof(positions) / sizeof(positions[0]))
+              << " positions at fixed depth, TT cleared per position\n" << std::endl;
+    
+    std::cout << "| Threads | Time(ms) | Nodes        | NPS          | NPS x | TTD x |" << std::endl;
+    std::cout << "|---------|----------|--------------|--------------|-------|-------|" << std::endl;
+    
+    double base_ms = 0.0;
+    double base_nps = 0.0;
+    
+    for (int threads : thread_counts) {
+        U64 total_nodes = 0;
+        double total_ms = 0.0;
+        
+        for (const ScalingPosition& sp : positions) {
+            TT::clear();
+            pos.parse_fen(sp.fen);
+            
+            auto start = std::chrono::high_resolution_clock::now();
+            SearchResult result = search_to_depth(pos, sp.depth, threads);
+            auto end = std::chrono::high_resolution_clock::now();
+            
+            total_nodes += result.nodes;
+            total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        
+        double nps = (total_ms > 0.0) ? total_nodes * 1000.0 / total_ms : 0.0;
+        if (threads == 1) {
+            base_ms = total_ms;
+            base_nps = nps;
+        }
+        
+        std::printf("| %7d | %8.0f | %12llu | %12.0f | %5.2f | %5.2f |\n",
+            threads, total_ms, (unsigned long long)total_nodes, nps,
+            base_nps > 0.0 ? nps / base_nps : 0.0,
+            total_ms > 0.0 ? base_ms / total_ms : 0.0);
+    }
+    
+    std::cout << "|---------|----------|--------------|--------------|-------|-------|" << std::endl;
+}
+
+// =============================================================================
+// Attack Lookup Benchmark
+// =============================================================================
+//
+//   bench attacks    rook + bishop lookups per second for each slider backend
+//
+// Occupancies are sampled from the perft suite positions and their children,
+// so the lookups hit the table the way move generation does. Both backends
+// must produce the same attack sets (checksums are compared).
+//
+// =============================================================================
+
+inline void run_attack_benchmark(Position& pos) {
+    constexpr int ROUNDS = 20000;
+    
+    std::vector<U64> samples;
+    for (const Perft::PerftCase& test : Perft::PERFT_SUITE) {
+        pos.parse_fen(test.fen);
+        samples.push_back(pos.occupancy[BOTH]);
+        
+        MoveList moves;
+        pos.generate_moves(moves);
+        for (int i = 0; i < moves.count; i++) {
+            pos.make_move(moves.moves[i].move, ALL_MOVES);
+            samples.push_back(pos.occupancy[BOTH]);
+            pos.unmake_move();
+        }
+    }
+    
+    int selected = slider_backend;
+    bool has_pext = AttackTables::cpu_has_pext();
+    
+    std::cout << "\n=== BATU ATTACK LOOKUP BENCHMARK ===" << std::endl;
+    std::cout << "Table: " << SLIDER_TABLE_SIZE << " entries (" << (sizeof(slider_attack_table) / 1024)
+              << " KB), " << samples.size() << " occupancies x 64 squares x 2 pieces" << std::endl;
+    std::cout << "Selected backend: " << AttackTables::slider_backend_name(selected) << "\n" << std::endl;
+    
+    std::cout << "| Backend | Time(ms) | Lookups      | Lookups/s    | Checksum         |" << std::endl;
+    std::cout << "|---------|----------|--------------|--------------|------------------|" << std::endl;
+    
+    U64 checksums[2] = {0ULL, 0ULL};
+    for (int backend = SLIDER_MAGIC; backend <= SLIDER_PEXT; backend++) {
+        if (backend == SLIDER_PEXT && !has_pext) {
+            std::printf("| %-7s | %8s | %12s | %12s | %-16s |\n",
+                AttackTables::slider_backend_name(backend), "-", "-", "-", "not supported");
+            continue;
+        }
+        
+        AttackTables::init_slider_attacks(backend);
+        
+        U64 checksum = 0ULL;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (U64 occ : samples) {
+                for (int square = 0; square < 64; square++) {
+                    checksum ^= Position::get_rook_attacks(square, occ);
+                    checksum += Position::get_bishop_attacks(square, occ);
+                }
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        
+        U64 lookups = static_cast<U64>(ROUNDS) * samples.size() * 128;
+        checksums[backend] = checksum;
+        
+        std::printf("| %-7s | %8lld | %12llu | %12llu | %016llx |\n",
+            AttackTables::slider_backend_name(backend), (long long)(us / 1000),
+            (unsigned long long)lookups,
+            (unsigned long long)(us > 0 ? lookups * 1000000 / us : 0),
+            (unsigned long long)checksum);
+    }
+    
+    std::cout << "|---------|----------|--------------|--------------|------------------|" << std::endl;
+    if (has_pext) {
+        std::cout << "\nChecksums " << (checksums[SLIDER_MAGIC] == checksums[SLIDER_PEXT] ? "match" : "DIFFER") << std::endl;
+    }
+    
+    // Restore the backend chosen at startup
+    AttackTables::init_slider_attacks(selected);
+}
+
+// =============================================================================
+// Batched Move Counting Benchmark
+// =============================================================================
+//
+//   bench movegen    positions/s of the 4-lane kernel vs generate_moves
+//
+// Positions are every node to depth 3 of the perft suite, stored compactly
+// and loaded by both paths (the workload of bulk jobs over unrelated
+// positions). Kernel counts are checked against generate_moves on the
+// lanes it reports as exact.
+//
+// =============================================================================
+
+struct StoredPosition {
+    U64 pieces[12];
+    int side;
+    int castling;
+    int enpassant;
+};
+
+inline void collect_positions(Position& pos, int depth, std::vector<StoredPosition>& out) {
+    StoredPosition stored;
+    std::memcpy(stored.pieces, pos.piece_bitboards, sizeof(stored.pieces));
+    stored.side = pos.side;
+    stored.castling = pos.castling;
+    stored.enpassant = pos.enpassant;
+    out.push_back(stored);
+    
+    if (depth == 0) return;
+    
+    MoveList moves;
+    pos.generate_moves(moves);
+    for (int i = 0; i < moves.count; i++) {
+        pos.make_move(moves.moves[i].move, ALL_MOVES);
+        collect_positions(pos, depth - 1, out);
+        pos.unmake_move();
+    }
+}
+
+inline void run_movegen_benchmark(Position& pos) {
+    constexpr int ROUNDS = 10;
+    
+    std::vector<StoredPosition> stored;
+    for (const Perft::PerftCase& test : Perft::PERFT_SUITE) {
+        pos.parse_fen(test.fen);
+        collect_positions(pos, 3, stored);
+    }
+    while (stored.size() % BatchGen::LANES) stored.pop_back();
+    size_t count = stored.size();
+    
+    std::cout << "\n=== BATU BATCHED MOVEGEN BENCHMARK ===" << std::endl;
+    std::cout << "Kernel: " << (BatchGen::USES_AVX2 ? "AVX2" : "scalar fallback") << ", "
+              << count << " positions x " << ROUNDS << " rounds\n" << std::endl;
+    
+    // Scalar: load each position and run the legal generator
+    std::vector<int> scalar_counts(count);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(pos.piece_bitboards, stored[i].pieces, sizeof(stored[i].pieces));
+            pos.update_occupancies();
+            pos.side = stored[i].side;
+            pos.castling = stored[i].castling;
+            pos.enpassant = stored[i].enpassant;
+            
+            MoveList moves;
+            pos.generate_moves(moves);
+            scalar_counts[i] = moves.count;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto scalar_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    
+    // Kernel: four positions per call
+    std::vector<BatchGen::LaneResult> batch_results(count);
+    BatchGen::Batch batch;
+    start = std::chrono::high_resolution_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < count; i += BatchGen::LANES) {
+            for (int lane = 0; lane < BatchGen::LANES; lane++) {
+                const StoredPosition& sp = stored[i + lane];
+                batch.set(lane, sp.pieces, sp.side, sp.castling, sp.enpassant);
+            }
+            BatchGen::count_moves(batch, &batch_results[i]);
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto batch_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    
+    size_t exact = 0, mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!batch_results[i].exact) continue;
+        exact++;
+        if (batch_results[i].moves != scalar_counts[i]) mismatches++;
+    }
+    
+    U64 total = static_cast<U64>(count) * ROUNDS;
+    std::cout << "| Path           | Time(ms) | Positions/s  |" << std::endl;
+    std::cout << "|----------------|----------|--------------|" << std::endl;
+    std::printf("| %-14s | %8lld | %12llu |\n", "generate_moves", (long long)(scalar_us / 1000),
+        (unsigned long long)(scalar_us > 0 ? total * 1000000 / scalar_us : 0));
+    std::printf("| %-14s | %8lld | %12llu |\n", "batch kernel", (long long)(batch_us / 1000),
+        (unsigned long long)(batch_us > 0 ? total * 1000000 / batch_us : 0));
+    std::cout << "|----------------|----------|--------------|" << std::endl;
+    
+    std::cout << "\nExact lanes: " << exact << "/" << count
+              << " (" << (count ? exact * 100 / count : 0) << "%), mismatches: " << mismatches << std::endl;
+}
+
+// =============================================================================
+// Perft Command
+// =============================================================================
+//
+//   perft <depth>           total leaf count
+//   perft divide <depth>    leaf count per root move
+//   perft suite [depth]     reference positions against known counts
+//
+// Optional arguments: "threads <n>" splits root moves across n threads,
+// "nohash" disables the perft table to measure raw move generation,
+// "batch" counts the last two plies with the 4-lane kernel.
+//
+// =============================================================================
+
+inline void parse_perft(Position& pos, char* command) {
+    int num_threads = 1;
+    char* threads_str = std::strstr(command, "threads");
+    if (threads_str != nullptr) {
+        num_threads = std::max(1, std::atoi(threads_str + 8));
+    }
+    bool use_hash = (std::strstr(command, "nohash") == nullptr);
+    bool batched = (std::strstr(command, "batch") != nullptr);
+    
+    char* suite_str = std::strstr(command, "suite");
+    if (suite_str != nullptr) {
+        std::unique_ptr<Position> suite_pos(new Position());
+        Perft::run_suite(*suite_pos, std::atoi(suite_str + 5), num_threads, use_hash, batched);
+        return;
+    }
+    
+    char* divide_str = std::strstr(command, "divide");
+    if (divide_str != nullptr) {
+        Perft::run(pos, std::atoi(divide_str + 7), num_threads, true, use_hash, batched);
+    } else {
+        Perft::run(pos, std::atoi(command + 6), num_threads, false, use_hash, batched);
+    }
+}
+
+// =============================================================================
+// Time Manager Simulator Command
+// =============================================================================
+//
+//   timesim <trace file> <clock> [<clock> ...]
+//
+// Clocks are "base+inc" or "moves/base+inc" in ms, e.g.
+// "timesim games.log 60000+1000 10000+100 40/120000".
+//
+// =============================================================================
+
+inline void parse_timesim(char* command) {
+    std::istringstream in(command + 7);
+    std::string path, clock;
+    std::vector<std::string> clocks;
+    
+    in >> path;
+    while (in >> clock)
+        clocks.push_back(clock);
+    
+    if (path.empty() || clocks.empty()) {
+        std::cout << "info string usage: timesim <trace file> <base+inc | moves/base+inc> ..." << std::endl;
+        return;
+    }
+    TimeMan::run_simulator(path.c_str(), clocks);
+}
+
+// =============================================================================
+// Tuning Commands
+// =============================================================================
+//
+//   spsa [iterations N] [nodes N]
+//
+// Tunes the registered search parameters by self-play (spsa.hpp); only a
+// BATU_TUNE build has any. Defaults: 100 iterations, 5000 nodes per move.
+//
+// =============================================================================
+
+// One spin option per registered search parameter (none in a normal build)
+inline void print_tunable_options() {
+    for (const Tune::Param& param : Tune::params()) {
+        std::cout << "option name " << param.name << " type spin default " << param.default_value
+                  << " min " << param.min << " max " << param.max << std::endl;
+    }
+}
+
+inline void parse_spsa(char* command) {
+    int iterations = 100;
+    U64 nodes = 5000;
+    
+    char* iterations_str = std::strstr(command, "iterations");
+    if (iterations_str != nullptr) {
+        iterations = std::max(1, std::atoi(iterations_str + 11));
+    }
+    char* nodes_str = std::strstr(command, "nodes");
+    if (nodes_str != nullptr) {
+        nodes = std::max(1ULL, std::strtoull(nodes_str + 6, nullptr, 10));
+    }
+    Spsa::run(iterations, nodes);
+}
+
 // =============================================================================
 // UCI Loop
 // =============================================================================
 
 inline void loop(Position& pos) {
-    char input[2000];
+    std::string line;
     
     std::cout << "id name Batu" << std::endl;
     std::cout << "id author Yunus Emre Halil" << std::endl;
     std::cout << "option name UseNN type check default " << (NN::nn_loaded ? "true" : "false") << std::endl;
+    std::cout << "option name Threads type spin default 1 min 1 max " << Search::MAX_THREADS << std::endl;
+    std::cout << "option name Deterministic type check default false" << std::endl;
+    std::cout << "option name TimeTrace type check default false" << std::endl;
+    std::cout << "option name MultiPV type spin default 1 min 1 max " << MAX_MOVES << std::endl;
+    std::cout << "option name Ponder type check default false" << std::endl;
+    std::cout << "option name EvalCache type spin default " << EvalCache::DEFAULT_MB
+              << " min 0 max " << EvalCache::MAX_MB << std::endl;
+    print_tunable_options();
     std::cout << "uciok" << std::endl;
     
     while (true) {
-        std::memset(input, 0, sizeof(input));
         std::fflush(stdout);
         
-        if (!std::fgets(input, 2000, stdin))
-            continue;
+        // End of input: let a bounded search finish, then exit. Lines have no
+        // length limit, a GUI sends the whole game in one "position" command.
+        if (!std::getline(std::cin, line)) {
+            if (active_limits.infinite || pondering.load())
+                Search::stop_search.store(true);
+            if (search_thread.joinable())
+                search_thread.join();
+            break;
+        }
         
+        line += '\n';     // The command parsers expect fgets-style lines
+        char* input = &line[0];
         if (input[0] == '\n')
             continue;
         
+        // Commands accepted while a search is running
         if (std::strncmp(input, "isready", 7) == 0) {
+            std::lock_guard<std::mutex> lock(output_mutex);
             std::cout << "readyok" << std::endl;
             continue;
         }
         
+        if (std::strncmp(input, "stop", 4) == 0) {
+            stop_search_thread();
+            continue;
+        }
+        
+        if (std::strncmp(input, "ponderhit", 9) == 0) {
+            ponder_hit();
+            continue;
+        }
+        
+        if (std::strncmp(input, "quit", 4) == 0) {
+            stop_search_thread();
+            break;
+        }
+        
+        // Everything else needs the position and tables: finish the search first
+        stop_search_thread();
+        
         if (std::strncmp(input, "setoption", 9) == 0) {
             if (std::strstr(input, "UseNN")) {
                 UseNN = (std::strstr(input, "true") != nullptr);
+                
+                // Cached and TT evals belong to the previous evaluator
+                EvalCache::clear();
+                TT::clear();
+            }
+            char* threads_str = std::strstr(input, "Threads value");
+            if (threads_str != nullptr) {
+                Threads = std::max(1, std::min(Search::MAX_THREADS, std::atoi(threads_str + 14)));
+            }
+            if (std::strstr(input, "Deterministic")) {
+                Deterministic = (std::strstr(input, "true") != nullptr);
+            }
+            if (std::strstr(input, "Ponder")) {
+                Ponder = (std::strstr(input, "true") != nullptr);
+            }
+            if (std::strstr(input, "TimeTrace")) {
+                TimeTrace = (std::strstr(input, "true") != nullptr);
+            }
+            char* multipv_str = std::strstr(input, "MultiPV value");
+            if (multipv_str != nullptr) {
+                MultiPV = std::max(1, std::min(MAX_MOVES, std::atoi(multipv_str + 14)));
+            }
+            char* evalcache_str = std::strstr(input, "EvalCache value");
+            if (evalcache_str != nullptr) {
+                EvalCacheMB = std::max(0, std::min(EvalCache::MAX_MB, std::atoi(evalcache_str + 16)));
+                EvalCache::resize(EvalCacheMB);
+            }
+            
+            // Tuning build: search parameters by name
+            char* name_str = std::strstr(input, "name ");
+            char* value_str = std::strstr(input, " value ");
+            if (name_str != nullptr && value_str != nullptr && value_str > name_str) {
+                Tune::set(std::string(name_str + 5, value_str), std::atoi(value_str + 7));
             }
             continue;
         }
@@ -438,9 +1017,9 @@ inline void loop(Position& pos) {
         }
         
         if (std::strncmp(input, "ucinewgame", 10) == 0) {
-            // Clear search state for new game
+            // Clear search state for new game (killers are per search)
             TT::clear();
-            Search::clear_killers();
+            EvalCache::clear();
             parse_position(pos, (char*)"position startpos");
             continue;
         }
@@ -454,21 +1033,59 @@ inline void loop(Position& pos) {
             int nn_score = NN::evaluate(pos.piece_bitboards, pos.side);
             int static_score = pos.evaluate();
             std::cout << "info string NN: " << nn_score << " cp, Static: " << static_score << " cp" << std::endl;
+            
+            // Mobility features (R, N, B, Q) from the batched kernel
+            const Position* lanes[BatchGen::LANES] = { &pos, nullptr, nullptr, nullptr };
+            BatchGen::Mobility mobility[BatchGen::LANES];
+            BatchGen::extract_mobility(lanes, mobility);
+            std::cout << "info string Mobility R/N/B/Q: white";
+            for (int type = 0; type < 4; type++) std::cout << " " << mobility[0].counts[WHITE][type];
+            std::cout << ", black";
+            for (int type = 0; type < 4; type++) std::cout << " " << mobility[0].counts[BLACK][type];
+            std::cout << std::endl;
             continue;
         }
         
         if (std::strncmp(input, "bench", 5) == 0) {
-            run_benchmark(pos);
+            char* threads_str = std::strstr(input, "threads");
+            if (std::strstr(input, "attacks"))
+                run_attack_benchmark(pos);
+            else if (threads_str != nullptr)
+                run_thread_benchmark(pos, std::atoi(threads_str + 7));
+            else if (std::strstr(input, "movegen"))
+                run_movegen_benchmark(pos);
+            else
+                run_benchmark(pos);
             continue;
         }
         
-        if (std::strncmp(input, "quit", 4) == 0)
-            break;
+        if (std::strncmp(input, "perft", 5) == 0) {
+            parse_perft(pos, input);
+            continue;
+        }
+        
+        if (std::strncmp(input, "timesim", 7) == 0) {
+            parse_timesim(input);
+            continue;
+        }
+        
+        if (std::strncmp(input, "spsa", 4) == 0) {
+            parse_spsa(input);
+            continue;
+        }
         
         if (std::strncmp(input, "uci", 3) == 0) {
             std::cout << "id name Batu" << std::endl;
             std::cout << "id author Yunus Emre Halil" << std::endl;
             std::cout << "option name UseNN type check default " << (NN::nn_loaded ? "true" : "false") << std::endl;
+            std::cout << "option name Threads type spin default 1 min 1 max " << Search::MAX_THREADS << std::endl;
+            std::cout << "option name Deterministic type check default false" << std::endl;
+            std::cout << "option name TimeTrace type check default false" << std::endl;
+            std::cout << "option name MultiPV type spin default 1 min 1 max " << MAX_MOVES << std::endl;
+            std::cout << "option name Ponder type check default false" << std::endl;
+            std::cout << "option name EvalCache type spin default " << EvalCache::DEFAULT_MB
+                      << " min 0 max " << EvalCache::MAX_MB << std::endl;
+            print_tunable_options();
             std::cout << "uciok" << std::endl;
         }
     }
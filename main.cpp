@@ -16,6 +16,7 @@
 #include "include/attacks.hpp"
 #include "include/nn_eval.hpp"
 #include "include/tt.hpp"
+#include "include/evalcache.hpp"
 #include "include/search.hpp"
 #include "include/uci.hpp"
 
@@ -27,6 +28,9 @@ int main() {
     TT::init_zobrist();
     TT::clear();
     
+    // Allocate the eval cache at its default size (EvalCache option)
+    EvalCache::resize(EvalCache::DEFAULT_MB);
+    
     // Initialize LMR reduction table
     Search::init_lmr();
     